@@ -13,8 +13,11 @@
 * - The Arduino device has not more than 32 kB of RAM.
 * - No dynamic memory allocation is used (malloc), to prevent heap fragmentation and improve robustness. 
 * - Thus: objects are either declared globally or within the scope of functions (=stack).
-* - The biggest object that is put on the stack is Player2 or Player3 which is about 1400 bytes.
-* - A song can have no more than MAX_NOTES notes. If set too high, the stack may destroy important data in RAM.
+* - The players (the biggest objects, a few kB) are not put on the stack: the player of the current mode is created in
+*   'playerRegion' (static, the size of the biggest player, see SharedRegion in Templates.h).
+* - A song can have no more than MAX_NOTES notes. The song and the players are static, so the linker reports when they
+*   do not fit in RAM. What is left is for the stack, which only holds small objects now. The highest MAX_NOTES that
+*   fits is computed from the sizes of the global objects and checked at compile time: see MAX_NOTES_CEILING (below).
 ***************************************************************************************************************************
 * About Arduino device support:
 *   This code has been tested with these 4 boards:   MKR 1000,   MKR WiFi 1010,   MKR Zero,   Nano 33 IoT.
@@ -25,23 +28,34 @@
 
 #include "Templates.h"
 #include "LedPanel.h"
+#include "LedDma.h"
 #include "Metronome.h"
 #include "Gloves.h"
 #include "FootPedal.h"
 #include "SdCard.h"
 #include "Midi.h"
+#include "MidiClock.h"
+#include "Recorder.h"
+#include "LatencyProbe.h"
+#include "FrameScheduler.h"
+#include "TextStrip.h"
+#include "Compositor.h"
+#include "LedSim.h"
 #include "APlayer0.h"  /* used in start screen and during song selection */
 #include "APlayer1.h"  /* while doing practice 1 (user controls pace/tempo/note lengths) */
 #include "APlayer2.h"  /* while doing practice 2 (system sets the pace/tempo/note lengths)  */
 #include "APlayer3.h"  /* while doing practice 3 (system sets the pace/tempo/note lengths)  */
 #include "APlayer4.h"  /* while doing practice 4 (learn to read notes)  */
 #include "APlayer5.h"  /* while doing practice 5 (learn to read notes)  */
+typedef SharedRegion<Player0, Player1, Player2, Player3, Player4, Player5> PlayerRegion;
 
 /* When NOT in practice mode, the user can switch between 3 Start-views/screens */
 #define START_VIEW_0_NONE         0
 #define START_VIEW_1_SCROLL       1  /* shows user and song, with a scroll text */
 #define START_VIEW_2_SETTINGS     2  /* shows settings */
 #define START_VIEW_3_PREVIEW      3  /* song preview / analysis */
+#define START_VIEW_4_DIAGNOSTICS  4  /* health counters (MIDI link), to tune the LED refresh policy */
+#define DIAGNOSTICS_SCROLL_MILLIS 30 /* health counters scroll 1 column every 30 ms */
 
 /* global objects */
 LedPanel      ledPanel;   /* panel with 5 LEDs for each piano key, also 4 push buttons (user, song, right/left, wifi) */
@@ -51,6 +65,31 @@ FootPedal     footPedal;  /* 3-switch foot pedal, mainly to control/navigate whi
 SdCard        sdCard;     /* SD Card with a file for each song, also for each user, and also a general settings file */
 Song          song;       /* represents the data of the loaded song */
 MidiInterface midi;       /* to exchange MIDI messages with the digital piano/keyboard */
+MidiClock     midiClock(&midi); /* optional MIDI clock: send to, or follow other MIDI devices while practicing */
+Recorder      recorder(&ledPanel); /* optional recording of what the user plays while practicing (MIDI file on SD card) */
+FrameScheduler frameScheduler(&ledPanel, &midi); /* writes the LED panel in safe gaps of the MIDI link (practice 1) */
+TextStrip     textStrip;  /* pre-rendered scroll text (user name, song id, song name) */
+PlayerRegion  playerRegion; /* the player of the current mode: start views or practice 1..5 (1 at a time) */
+#ifdef LEDPANEL_SIMULATOR
+LedSim        ledSim;     /* no LED strips: frames of the LED panel are rendered to Serial (see LedSim.h) */
+#endif
+#ifdef DEBUG_MODE
+LatencyProbe  latencyProbe(&ledPanel); /* instrumentation: latency from key press to LED panel (see test_KeyToLedLatency) */
+#endif
+
+/* RAM budget (see 'About memory' above): the global objects, plus what the Arduino core and libraries use (USB, Serial
+*  and SD card buffers, WiFi) and the stack. Song::notes is the only part that can grow: MAX_NOTES_CEILING is the highest
+*  MAX_NOTES that fits next to the other objects (each note is 1 SongNote). MAX_NOTES is checked against it at compile
+*  time (printed by printDiagnostics), the linker checks the rest. */
+#define RAM_BYTES        32768   /* SAMD21 */
+#define RAM_RESERVED      8192   /* Arduino core and libraries (about 4 kB) + stack (4 kB, players are not on the stack) */
+constexpr size_t globalObjectsBytes = sizeof(ledPanel) + sizeof(metronome) + sizeof(gloves) + sizeof(footPedal)
+  + sizeof(sdCard) + sizeof(song) + sizeof(midi) + sizeof(midiClock) + sizeof(recorder) + sizeof(frameScheduler)
+  + sizeof(textStrip) + sizeof(PlayerRegion);
+constexpr size_t otherObjectsBytes = globalObjectsBytes - MAX_NOTES * sizeof(SongNote);  /* all but Song::notes */
+static_assert(otherObjectsBytes + RAM_RESERVED <= RAM_BYTES, "global objects do not fit in RAM, even without notes");
+constexpr size_t MAX_NOTES_CEILING = (RAM_BYTES - RAM_RESERVED - otherObjectsBytes) / sizeof(SongNote);
+static_assert(MAX_NOTES <= MAX_NOTES_CEILING, "Song::notes does not fit in RAM: lower MAX_NOTES (see MAX_NOTES_CEILING)");
 
 /* include for Wifi depends on chip on Arduino board */
 #include <SPI.h>
@@ -67,7 +106,11 @@ bool setupSucceed = false;
 * Arduino setup()
 *******************************************************************************************************************************/
 void setup() {
-#ifdef DEBUG_MODE
+#ifdef LEDPANEL_SIMULATOR
+  Serial.begin(115200);  /* frames of the LED panel need the speed, debug output (if any) goes along */
+  ledSim.begin(&Serial, LEDSIM_ANSI, 4 /* gain */, NULL);
+  ledPanel.setSimulator(&ledSim);
+#elif defined(DEBUG_MODE)
   Serial.begin(9600);
   // while (!Serial) { ; } /* wait for serial port to connect. Needed for native USB port only */
 #endif
@@ -77,7 +120,12 @@ void setup() {
     return; 
   }
   midi.init_MIDI();
+  midi.setRecorder(&recorder);
+  ledPanel.setMidi(&midi);
+  ledPanel.setMetronome(&metronome);  /* metronome LEDs are written together with the LED panel */
   sdCard.loadSettings();
+  midiClock.mode = Settings::midiClock;
+  if (Settings::latencyMidi == LATENCY_AUTO) calibrateMidiLatency();
   sdCard.loadUser(Settings::lastUser);
   sdCard.loadSong(&song, User::lastSong, getSongLoadingFlags());
 
@@ -103,6 +151,7 @@ void loop() {
   byte practiceId = doStartViews(startView, &resetStartMeasureNr);
   if (resetStartMeasureNr) startMeasureNr = 1;
   
+  if (Settings::record) recorder.startRecording();  /* every practice session is recorded in a new MIDI file */
   // play & practice here
   switch(practiceId) {
     case PRACTICE_1:
@@ -121,6 +170,10 @@ void loop() {
       startMeasureNr = doPractice5(startMeasureNr);  /* learn to read music notes */
       break;
   } 
+  recorder.stopRecording();
+#ifdef DEBUG_MODE
+  printDiagnostics();
+#endif
   startView = START_VIEW_2_SETTINGS;
 }
 
@@ -128,7 +181,7 @@ void loop() {
 
 byte doStartViews(int startView, bool* resetStartMeasureNr) {
   *resetStartMeasureNr = false;
-  Player0   player(&midi, &metronome, &ledPanel);        /* Simple player: play song via MIDI and show LEDs in simple way */
+  Player0&  player = playerRegion.create<Player0>(&midi, &metronome, &ledPanel); /* Simple player: play song via MIDI and show LEDs in simple way */
   int pKey; /* pressed piano key */
   int x; /* column on LED panel */
   int view = startView;
@@ -174,7 +227,7 @@ byte doStartViews(int startView, bool* resetStartMeasureNr) {
         if (User::tempoFactor < 10)  User::tempoFactor = 10;     /* min tempo-factor in percentage */
         if (canLimitPanelRows && x >= 42 && x <= 53) User::panelRowsUsed ^= 4; /* toggle between 5 and 1 (1 XOR 4 = 5, 5 XOR 4 = 1) */
         if (canLeftHandCue && x == 40) User::leftHandCue = !User::leftHandCue; /* toggle left hand cue (grey LED) above notes on/off */
-        if (x == 60) { if (++User::globalBrightness > 3) User::globalBrightness = 0; ledPanel.setGlobalBrightness(User::globalBrightness); }
+        if (x == 60) { if (++User::globalBrightness >= PANEL_BRIGHTNESS_LEVELS) User::globalBrightness = 0; ledPanel.setGlobalBrightness(User::globalBrightness); }
         delay(50);
         break;
       /* screen to show song analysis and to play the song  */
@@ -186,6 +239,11 @@ byte doStartViews(int startView, bool* resetStartMeasureNr) {
         }
         if (player.isPlaying) player.handlePlaying();
         break;
+      /* screen to show health counters, press lowest piano key to reset them */
+      case START_VIEW_4_DIAGNOSTICS:
+        displayDiagnosticsScroll(needInit);
+        if (pKey == MIDI_PITCH_MIN) { midi.resetLinkStats(); ledPanel.resetFrameStats(); frameScheduler.resetStats(); }
+        break;
     }
     formerView = view;
     /* read foot pedals */
@@ -215,8 +273,8 @@ byte doStartViews(int startView, bool* resetStartMeasureNr) {
     bool isBtnWifi   = ledPanel.isButtonPressed(BUTTON_WIFI);   /* receive new song files/versions wirelessly */
     /* nav to next/former screen */
     if ((isPedalR || isPedalL)) {
-      if (isPedalR) { view = (view == START_VIEW_3_PREVIEW ? START_VIEW_1_SCROLL  : view + 1); } /* next screen */
-      if (isPedalL) { view = (view == START_VIEW_1_SCROLL  ? START_VIEW_3_PREVIEW : view - 1); } /* former screen */
+      if (isPedalR) { view = (view == START_VIEW_4_DIAGNOSTICS ? START_VIEW_1_SCROLL      : view + 1); } /* next screen */
+      if (isPedalL) { view = (view == START_VIEW_1_SCROLL      ? START_VIEW_4_DIAGNOSTICS : view - 1); } /* former screen */
       *resetStartMeasureNr = true; /* when same song is practiced again, always start at measure 1 */
       player.stopPlayingNow(); /* stop playing song when switching view */
     }
@@ -238,6 +296,33 @@ byte doStartViews(int startView, bool* resetStartMeasureNr) {
 }
 
 
+/******************************************************************************************************************************
+* 'LatencyMidi:auto' in SETTINGS.TXT: measure latency of the piano with the round-trip time of its MIDI echo.
+* Half of the round-trip time is used (one way). The result is saved in SETTINGS.TXT, set 'auto' again to measure again.
+* Without echo the default (DEFAULT_LATENCY_MIDI) is saved.
+*******************************************************************************************************************************/
+void calibrateMidiLatency() {
+  char charBuf[8];
+  displayMsg("MIDI", COLOR_IDX_BLUE);
+  int roundTrip = midi.measureEchoRoundTrip();
+  if (roundTrip < 0) {
+    displayMsg("NO ECHO", COLOR_IDX_RED);  /* piano does not echo MIDI (or is off): not measured at each start-up anymore */
+    Settings::latencyMidi = DEFAULT_LATENCY_MIDI;
+  }
+  else {
+    Settings::latencyMidi = roundTrip / 2;
+    itoa(Settings::latencyMidi, charBuf, 10);
+    strcat(charBuf, " MS");
+    displayMsg(charBuf, COLOR_IDX_GREEN);
+  }
+#ifdef DEBUG_MODE
+  Serial.print("MIDI echo round-trip (ms): "); Serial.println(roundTrip);
+#endif
+  sdCard.saveSettingsIfDirty();
+  delay(800);
+}
+
+
 /******************************************************************************************************************************
 * Save changed User settings to SD Card.
 *******************************************************************************************************************************/
@@ -301,6 +386,7 @@ void selectUser() {
 void selectSong() {
   metronome.working = METRONOME_OFF;
   Player0   player(&midi, &metronome);           /* Simple player: just play song via MIDI (no metronome, no LEDs)  */
+                                                 /* (small, on stack: playerRegion holds the player of doStartViews) */
   int pKey; /* pressed piano key */
   bool songLoaded = false;     /* cannot cancel song selection with button after song has been loaded for preview listening */
   int selected = song.songId;  /* currently loaded songId */
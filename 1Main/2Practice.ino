@@ -1,3 +1,7 @@
+#define PAUSE_RESUME  0     /* see doHandlePause() */
+#define PAUSE_QUIT    1
+#define PAUSE_LOOP    2     /* A-B loop changed while paused */
+
 
 
 
@@ -5,10 +9,11 @@
 * Practice 1 : practice where user sets the pace 
 *******************************************************************************************************************************/
 int doPractice1(int startMeasureNr) {
-  Player1 player(&midi, &ledPanel, &gloves);
+  Player1& player = playerRegion.create<Player1>(&midi, &ledPanel, &gloves, &frameScheduler);
   player.startSong(&song, startMeasureNr, User::isGloves /* use vibrating gloves? */, User::panelRowsUsed, User::isPracticeRepeat /* repeat song? */);
   while (true) {
     player.handlePlaying();
+    recorder.handleWriting();       /* recorded piano keys are written to SD card here, never while handling playing */
     footPedal.readPedals(millis());
     if (footPedal.isMiddlePressed()) break;  /* quit practicing: return to loop() */
     bool leftDown = footPedal.isLeftDown();
@@ -34,26 +39,41 @@ int doPractice1(int startMeasureNr) {
 int doPractice2(int startMeasureNr) {
   byte midiPlay = User::playWhilePractice; /* should song play via MIDI while practicing? */
   metronome.working = User::metronome;
-  Player2 player(&ledPanel, &metronome, &midi, &gloves);
+  Player2& player = playerRegion.create<Player2>(&ledPanel, &metronome, &midi, &gloves, &midiClock);
   player.startSong(&song, startMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::isPracticeRepeat);
   bool pReleased = false;  /* before responding to middle foot pedal, it should be released once */
+  int loopStartNr = 0;     /* A-B loop (0 = no loop), set while paused: see doHandlePause() */
+  int loopEndNr = 0;
+  midi.takeLastPressedKey();       /* forget keys pressed before (start views): see doHandleTempoKeys() */
   while (true) {
     player.handlePlaying();
+    recorder.handleWriting();       /* recorded piano keys are written to SD card here, never while handling playing */
+    if (doHandleTempoKeys()) player.changeTempoFactor(User::tempoFactor);  /* the song continues at the new tempo */
     footPedal.readPedals(millis());
     if (!pReleased && footPedal.isMiddleReleased()) {
       pReleased = true;
     }
     if (pReleased && footPedal.isMiddleDown()) {
       player.suspendPlaying();
-      bool doQuit = doHandlePause();
-      if (doQuit) break;
-      player.resumePlaying();
+      byte pause = doHandlePause(player.curMeasureNr, &loopStartNr, &loopEndNr);
+      if (pause == PAUSE_QUIT) break;
+      if (pause == PAUSE_LOOP) {  /* loop changed: restart song at start of loop (or current measure when no loop) */
+        int newMeasureNr = (loopStartNr > 0) ? loopStartNr : player.curMeasureNr;
+        player.stopPlayingNow();
+        player.setLoop(loopStartNr, loopEndNr);
+        player.startSong(&song, newMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::isPracticeRepeat);
+      }
+      else {
+        player.resumePlaying();
+        player.changeTempoFactor(User::tempoFactor);  /* tempo changed while paused: no restart */
+      }
     }
     bool leftDown = footPedal.isLeftDown();
     bool rightDown = footPedal.isRightDown();
     if (leftDown || rightDown) {
       player.stopPlayingNow();
       int newMeasureNr = doPedalNavigation(player.curMeasureNr, leftDown ? true : false); /* handle left/right pedal navigation */
+      if (loopStartNr > 0) newMeasureNr = constrain(newMeasureNr, loopStartNr, loopEndNr); /* stay within the loop */
       /* restart song starting at measure 'newMeasureNr' */
       player.startSong(&song, newMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::isPracticeRepeat);
     }
@@ -71,26 +91,41 @@ int doPractice2(int startMeasureNr) {
 int doPractice3(int startMeasureNr) {
   byte midiPlay = User::playWhilePractice; /* should song play via MIDI while practicing? */
   metronome.working = User::metronome;
-  Player3 player(&ledPanel, &metronome, &midi, &gloves);
+  Player3& player = playerRegion.create<Player3>(&ledPanel, &metronome, &midi, &gloves, &midiClock);
   player.startSong(&song, startMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::animationSpeed, User::isPracticeRepeat);
   bool pReleased = false;  /* before responding to middle foot pedal, it should be released once */
+  int loopStartNr = 0;     /* A-B loop (0 = no loop), set while paused: see doHandlePause() */
+  int loopEndNr = 0;
+  midi.takeLastPressedKey();       /* forget keys pressed before (start views): see doHandleTempoKeys() */
   while (true) {
     player.handlePlaying();
+    recorder.handleWriting();       /* recorded piano keys are written to SD card here, never while handling playing */
+    if (doHandleTempoKeys()) player.changeTempoFactor(User::tempoFactor);  /* the song continues at the new tempo */
     footPedal.readPedals(millis());
     if (!pReleased && footPedal.isMiddleReleased()) {
       pReleased = true;
     }
     if (pReleased && footPedal.isMiddleDown()) {
       player.suspendPlaying();
-      bool doQuit = doHandlePause();
-      if (doQuit) break;
-      player.resumePlaying();
+      byte pause = doHandlePause(player.curMeasureNr, &loopStartNr, &loopEndNr);
+      if (pause == PAUSE_QUIT) break;
+      if (pause == PAUSE_LOOP) {  /* loop changed: restart song at start of loop (or current measure when no loop) */
+        int newMeasureNr = (loopStartNr > 0) ? loopStartNr : player.curMeasureNr;
+        player.stopPlayingNow();
+        player.setLoop(loopStartNr, loopEndNr);
+        player.startSong(&song, newMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::animationSpeed, User::isPracticeRepeat);
+      }
+      else {
+        player.resumePlaying();
+        player.changeTempoFactor(User::tempoFactor);  /* tempo changed while paused: no restart */
+      }
     }
     bool leftDown = footPedal.isLeftDown();
     bool rightDown = footPedal.isRightDown();
     if (leftDown || rightDown) {
       player.stopPlayingNow();
       int newMeasureNr = doPedalNavigation(player.curMeasureNr, leftDown ? true : false); /* handle left/right pedal navigation */
+      if (loopStartNr > 0) newMeasureNr = constrain(newMeasureNr, loopStartNr, loopEndNr); /* stay within the loop */
       /* restart song starting at measure 'newMeasureNr' */
       player.startSong(&song, newMeasureNr, User::isGloves, midiPlay, User::tempoFactor, User::animationSpeed, User::isPracticeRepeat);
     }
@@ -107,10 +142,11 @@ int doPractice3(int startMeasureNr) {
 *******************************************************************************************************************************/
 int doPractice4(int startMeasureNr) {
   byte midiPlay = User::playWhilePractice; /* should song play via MIDI while practicing? */
-  Player4 player(&midi, &ledPanel);
+  Player4& player = playerRegion.create<Player4>(&midi, &ledPanel);
   player.startSong(&song, startMeasureNr, midiPlay);
   while (true) {
     player.handlePlaying();
+    recorder.handleWriting();       /* recorded piano keys are written to SD card here, never while handling playing */
     footPedal.readPedals(millis());
     if (footPedal.isMiddlePressed()) break;  /* quit practicing: return to loop() */
     bool leftDown = footPedal.isLeftDown();
@@ -133,10 +169,11 @@ int doPractice4(int startMeasureNr) {
 *******************************************************************************************************************************/
 int doPractice5(int startMeasureNr) {
   byte midiPlay = User::playWhilePractice; /* should song play via MIDI while practicing? */
-  Player5 player(&midi, &ledPanel);
+  Player5& player = playerRegion.create<Player5>(&midi, &ledPanel);
   player.startSong(&song, startMeasureNr, midiPlay, User::isPracticeRepeat /* repeat song? */);
   while (true) {
     player.handlePlaying();
+    recorder.handleWriting();       /* recorded piano keys are written to SD card here, never while handling playing */
     footPedal.readPedals(millis());
     if (footPedal.isMiddlePressed()) break;  /* quit practicing: return to loop() */
     bool leftDown = footPedal.isLeftDown();
@@ -156,9 +193,54 @@ int doPractice5(int startMeasureNr) {
 }
 
 
-bool doHandlePause() {
+/******************************************************************************************************************************
+* Tempo while playing (practice 2 and 3): all 3 pedals are taken (pause, navigation), so piano keys outside the song are
+* used. A key below the lowest note of the song: 5% slower, above the highest note: 5% faster. Returns true if
+* User::tempoFactor changed: the player continues at the new tempo (its changeTempoFactor(), no restart). Keys are read by
+* the player (MidiClock, see MidiInterface::takeLastPressedKey), only the last key of each loop counts. The piano key that
+* starts practice 2 is not a tempo key (it is taken by getPressedPianoKey).
+*******************************************************************************************************************************/
+bool doHandleTempoKeys() {
+  int pKey = midi.takeLastPressedKey();
+  if (pKey == 0) return false;
+  bool* isUsed = song.getSongAnalysis();  /* for each piano key: used in song? */
+  int lowest = 0;
+  while (lowest < MAX_UNIQUE_PITCHES && !isUsed[lowest]) lowest++;
+  int highest = MAX_UNIQUE_PITCHES - 1;
+  while (highest > lowest && !isUsed[highest]) highest--;
+  if (lowest == MAX_UNIQUE_PITCHES) return false;  /* no notes */
+  if (pKey < MIDI_PITCH_MIN + lowest) changeUserTempoFactor(-5);
+  else if (pKey > MIDI_PITCH_MIN + highest) changeUserTempoFactor(5);
+  else return false;  /* key of the song: the user plays along */
+  return true;
+}
+
+
+/* User::tempoFactor 'delta' % slower or faster (10% - 180%) */
+void changeUserTempoFactor(int delta) {
+  User::tempoFactor += delta;
+  if (User::tempoFactor > 180) User::tempoFactor = 180;    /* max tempo-factor in percentage */
+  if (User::tempoFactor < 10)  User::tempoFactor = 10;     /* min tempo-factor in percentage */
+}
+
+
+/******************************************************************************************************************************
+* Pause: the middle pedal is kept down. Released after a long press: resume. Released after a short press: quit.
+* While paused: left or right pedal (released): tempo 5% slower or faster (User::tempoFactor, the song continues at the new
+* tempo when resumed; while playing, see doHandleTempoKeys). Left and right pedal down together: loop the measures
+* between the bookmarks around the current measure, or no loop when there was a loop. The LED panel shows the new tempo
+* (or start measure) while paused.
+*******************************************************************************************************************************/
+byte doHandlePause(int curMeasureNr, int* loopStartNr, int* loopEndNr) {
+  byte panel[PANEL_LEDS];     /* LED panel of the player, shown again when resumed */
+  bool isPanelChanged = false;
+  bool isLoopChanged = false;
+  bool isBothDown = false;    /* left and right pedal were down together (no tempo change when released) */
   bool isReleased = false;
   uint32_t now, down = 0;
+  for (int x = 0; x < PANEL_COLS; x++) {
+    for (int y = 0; y < PANEL_ROWS; y++) panel[x * PANEL_ROWS + y] = ledPanel.getPixel(x, y);
+  }
   delay(50); /* wait 50 ms, to deal with possible switch bounce of foot pedal */
   while(!isReleased) { /* as long as pedal is DOWN */
     now = millis();
@@ -167,11 +249,46 @@ bool doHandlePause() {
     if (!isReleased) {
       down = footPedal.getMiddletDownTime(now);
     }
+    if (!isBothDown && footPedal.isLeftDown() && footPedal.isRightDown()) {  /* loop on/off */
+      isBothDown = true;
+      if (*loopStartNr > 0) *loopStartNr = *loopEndNr = 0;
+      else song.getBookmarkSection(curMeasureNr, loopStartNr, loopEndNr);
+      isLoopChanged = true;
+      doShowNumber((*loopStartNr > 0) ? *loopStartNr : curMeasureNr);  /* measure where the song restarts */
+      isPanelChanged = true;
+    }
+    bool leftReleased = footPedal.isLeftReleased();
+    if (leftReleased || footPedal.isRightReleased()) {
+      if (!isBothDown) {  /* tempo 5% slower (left) or faster (right) */
+        changeUserTempoFactor(leftReleased ? -5 : 5);
+        doShowNumber(User::tempoFactor);
+        isPanelChanged = true;
+      }
+      if (!footPedal.isLeftDown() && !footPedal.isRightDown()) isBothDown = false;
+    }
+    recorder.handleWriting();
     delay(9); /* loop about 100 times/sec */    
   }
   delay(50); /* wait 50 ms, to deal with possible switch bounce of foot pedal */
-  if (down > 400) return false;   /* resume practicing */
-  return true;                    /* stop practicing, go to start screen */  
+  if (isLoopChanged) return PAUSE_LOOP;  /* restart song with the new loop */
+  if (isPanelChanged) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      for (int y = 0; y < PANEL_ROWS; y++) ledPanel.setPixel(x, y, panel[x * PANEL_ROWS + y]);
+    }
+    ledPanel.writeLeds_asm();
+  }
+  if (down > 400) return PAUSE_RESUME;   /* resume practicing */
+  return PAUSE_QUIT;                     /* stop practicing, go to start screen */  
+}
+
+
+/* Number (tempo or measure-nr) on the LED panel, while the song is paused or navigated */
+void doShowNumber(int nr) {
+  char charBuf[5];
+  itoa(nr, charBuf, 10);
+  ledPanel.clear(); /* clear all LEDs in data structure */
+  ledPanel.writeText(charBuf, 25 + PANEL_LEFT_MARGIN, COLOR_IDX_WHITE);
+  ledPanel.writeLeds_asm();
 }
 
 
@@ -17,38 +17,107 @@ int displayMsg(const char* msg, byte color) {
 
 /******************************************************************************************************************************
 * Scroll text-info on the LED-panel: NAME USER + ID SONG + NAME SONG
-* bool init: call once with 'TRUE' to initialize the scroll.
+* bool init: call once with 'TRUE' to initialize the scroll (text is rendered once in 'textStrip').
 *            call repeatedly with 'FALSE' to write text to LED panel and move a LED-pixel each time.
 *******************************************************************************************************************************/
 void displayUserAndSongScroll(bool init, bool settingsDirty) {
-  static char charBuf[4]; /* to store songId in text */
-  static int wUser, wSong, wSongId; /* widths in LEDs */
-  static int xUser, xSong, xSongId, x;    /* x (=column) of LED panel */
+  static int x;                   /* x (=column) of LED panel where the text strip starts */
   if (init) {
+    char charBuf[4];              /* to store songId in text */
+    char warning[30];             /* queues that the song would overflow */
     itoa(song.songId, charBuf, 10);
-    wUser = ledPanel.getTextWidth(User::userName) + 7; /* width of user name text */
-    wSong = ledPanel.getTextWidth(song.songName) + 7;  /* width of song name text */
-    wSongId = ledPanel.getTextWidth(charBuf) + 7;      /* width of song-id text */
-    xUser = PANEL_COLS - 1;              /* start scrolling from the very right, column 60 */
-    xSongId = xUser + wUser;
-    xSong = xSongId + wSongId;
+    textStrip.clear();
+    textStrip.addText(&ledPanel, User::userName, ledPanel.getUserColorIdx(User::userId)); /* each user has own color */
+    textStrip.addSpace(7);
+    textStrip.addText(&ledPanel, charBuf, COLOR_IDX_WHITE);
+    textStrip.addSpace(7);
+    if (getSongCapacityWarning(warning)) {
+      textStrip.addText(&ledPanel, warning, COLOR_IDX_RED);  /* before the song name: a long name is cut off */
+      textStrip.addSpace(7);
+    }
+    textStrip.addText(&ledPanel, song.songName, COLOR_IDX_YELLOW);
+    textStrip.addSpace(7);
+    x = PANEL_COLS - 1;           /* start scrolling from the very right */
   }
-  int wAll = wUser + wSongId + wSong;
   ledPanel.clear(); /* clear all LEDs in data structure */
-  x = xUser;
-  byte clrUser = ledPanel.getUserColorIdx(User::userId); /* each user has own color */
-  while (x < PANEL_COLS) { ledPanel.writeText(User::userName, x, clrUser); x += wAll; }
-  x = xSongId;
-  while (x < PANEL_COLS) { ledPanel.writeText(charBuf, x, COLOR_IDX_WHITE); x += wAll; }
-  x = xSong;
-  while (x < PANEL_COLS) { ledPanel.writeText(song.songName, x, COLOR_IDX_YELLOW); x += wAll; }
+  textStrip.draw(&ledPanel, x);
   if (settingsDirty) ledPanel.setPixel(0, 4, COLOR_IDX_RED); /* set RED pixel to reveal dirty state to user */
   ledPanel.writeLeds_asm();
-  xUser--;  xSongId--; xSong--;    /* scroll to left when called next time */
-  if (xUser < -wUser && xUser < xSong) xUser = xSong + wSong; /* user-name scrolled out of the LED panel? */
-  if (xSongId < -wSongId && xSongId < xUser) xSongId = xUser + wUser; /* song-id scrolled out of the LED panel? */
-  if (xSong < -wSong && xSong < xSongId) xSong = xSongId + wSongId; /* song-name scrolled out of the LED panel? */
+  x--;                            /* scroll to left when called next time */
+  if (x < -textStrip.width) x += textStrip.width;  /* strip repeats itself */
+}
+
+/******************************************************************************************************************************
+* The song would overflow a fixed-size queue of the players (see CapacityPlanner): 'FULL:' and the queues, e.g. 'FULL:LED MIDI'
+* (LED = LED-off schedule, MIDI = MIDI note-offs, AHEAD = upcoming notes, GLOVES = glove commands). False if the song fits.
+*******************************************************************************************************************************/
+bool getSongCapacityWarning(char* charBuf) {
+  strcpy(charBuf, "FULL:");
+  if (song.capacity.sounding > LED_OFF_SCHEDULE_MAX)    strcat(charBuf, "LED ");
+  if (song.capacity.sounding > MIDI_MAX_DELAYED_MSG)    strcat(charBuf, "MIDI ");
+  if (song.capacity.upcoming > UPCOMING_NOTES_MAX)      strcat(charBuf, "AHEAD ");
+  if (song.capacity.gloveCommands > GLOVE_COMMANDS_MAX) strcat(charBuf, "GLOVES ");
+  int len = strlen(charBuf);
+  if (len == 5) return false;    /* only 'FULL:' */
+  charBuf[len - 1] = 0;          /* remove last space */
+  return true;
+}
+
+
+/******************************************************************************************************************************
+* Scroll health counters on the LED-panel: 'OVR:0 FERR:0 SYNC:0 RXFULL:0 SENT:0 SKIP:0'
+* OVR = UART overruns, FERR = framing errors, SYNC = parser resyncs, RXFULL = receive buffer found full (bytes may be lost)
+* SENT = LED frames written, SKIP = LED frames not written (identical to last frame)
+* bool init: call once with 'TRUE' to initialize the scroll. Counters are read again every call, but the LED panel is only
+* written when the scroll moves (every DIAGNOSTICS_SCROLL_MILLIS) or a MIDI counter changed: writing the LED panel disables
+* interrupts, which would disturb the counters it shows. The LED frame counters change by writing the LED panel itself, so
+* they are updated with the scroll only.
+*******************************************************************************************************************************/
+void displayDiagnosticsScroll(bool init) {
+  static int x;                   /* x (=column) of LED panel */
+  static uint32_t lastScrollMillis;
+  static char lastMidiBuf[60];    /* MIDI counters shown now */
+  char charBuf[120];
+  uint32_t now = millis();
+  bool isMoved = false;
+  if (init) { x = PANEL_COLS - 1; lastScrollMillis = now; lastMidiBuf[0] = 0; }   /* start scrolling from the very right */
+  int len = sprintf(charBuf, "OVR:%u FERR:%u SYNC:%u RXFULL:%u ", midi.overruns, midi.framingErrors, midi.resyncs,
+                    midi.bufferFullEvents);
+  bool isChanged = (strcmp(charBuf, lastMidiBuf) != 0);
+  strcpy(lastMidiBuf, charBuf);
+  sprintf(charBuf + len, "SENT:%lu SKIP:%lu DEFER:%lu FORCE:%lu", ledPanel.framesSent, ledPanel.framesSkipped,
+          frameScheduler.framesDeferred, frameScheduler.framesForced);
+  int wAll = ledPanel.getTextWidth(charBuf) + 7;
+  if (now - lastScrollMillis >= DIAGNOSTICS_SCROLL_MILLIS) {
+    lastScrollMillis = now;
+    x--;                          /* scroll to left */
+    if (x < -wAll) x += wAll;
+    isMoved = true;
+  }
+  if (!isMoved && !isChanged) return;   /* nothing changed on the LED panel */
+  ledPanel.clear(); /* clear all LEDs in data structure */
+  for (int xText = x; xText < PANEL_COLS; xText += wAll) ledPanel.writeText(charBuf, xText, COLOR_IDX_WHITE);
+  ledPanel.writeLeds_asm();
+}
+
+#ifdef DEBUG_MODE
+/******************************************************************************************************************************
+* Print health counters to the serial monitor (after each practice session), to tune the LED refresh policy.
+*******************************************************************************************************************************/
+void printDiagnostics() {
+  Serial.print("MIDI overruns: ");        Serial.println(midi.overruns);
+  Serial.print("MIDI framing errors: ");  Serial.println(midi.framingErrors);
+  Serial.print("MIDI parser resyncs: ");  Serial.println(midi.resyncs);
+  Serial.print("MIDI rx buffer full: ");  Serial.println(midi.bufferFullEvents);
+  Serial.print("LED frames sent: ");      Serial.println(ledPanel.framesSent);
+  Serial.print("LED frames skipped: ");   Serial.println(ledPanel.framesSkipped);
+  Serial.print("Interrupts not disabled (ms): "); Serial.println(ledPanel.framesSkipped * LEDPANEL_MISSED_MILLIS);
+  Serial.print("LED frames deferred: ");  Serial.println(frameScheduler.framesDeferred);
+  Serial.print("LED frames forced: ");    Serial.println(frameScheduler.framesForced);
+  Serial.print("Max notes: ");            Serial.print(MAX_NOTES);
+  Serial.print(" (fits in RAM: ");        Serial.print(MAX_NOTES_CEILING); Serial.println(")");
 }
+#endif
 
 /******************************************************************************************************************************
 * Display settings. Example: '2.. M H [120]'
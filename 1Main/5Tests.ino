@@ -155,6 +155,9 @@ void test_DumpSongData() {
   Serial.print("resolution: "); Serial.println(song.resolution);
   Serial.print("totalTicks: "); Serial.println(song.totalTicks);
   Serial.print("lastMeasureNr: "); Serial.println(song.lastMeasureNr);
+  Serial.print("capacity: sounding "); Serial.print(song.capacity.sounding);  /* see CapacityPlanner */
+  Serial.print(", upcoming "); Serial.print(song.capacity.upcoming);
+  Serial.print(", gloveCommands "); Serial.println(song.capacity.gloveCommands);
   for (int i=0; i<song.noteCount; i++) {
     SongNote* n = &song.notes[i];
     if (n->type == TYPE_MEASURE || n->type == TYPE_MEASURE_BM) /* measure or measure with bookmark flag */
@@ -384,18 +387,32 @@ void test_DelayManager() {
     delayMgr.add(arr_val[i], now + arr_ms[i]);
   }
   delayMgr.dump();
-  /* wait for data to be released in the right order */
+  delayMgr.scaleDelays(now + 300, 1, 2);  /* twice as fast after 300 ms (tempo change): same order, 5000 ms becomes 2650 ms */
+  delayMgr.dump();
+  /* wait for data to be released in the right order, each at its rescaled time */
+  int errors = 0;
+  uint32_t lastTime = 0;
+  uint32_t actTime;
+  uint32_t start = now;
   while (delayMgr.count() > 0)
   {
     delay(5);
     now = millis();
+    if (delayMgr.peekFirst(actTime) == NULL) break;
     b = delayMgr.checkForRelease(now);
     if (b != NULL) {
+      int ms = arr_ms[*b - 1];
+      uint32_t expected = start + ((ms <= 300) ? ms : 300 + (ms - 300) / 2);
+      if (actTime != expected || actTime < lastTime) errors++;
+      lastTime = actTime;
       Serial.print("Released: ");
-      Serial.println(*b);
-      delayMgr.dump();
+      Serial.print(*b);
+      Serial.print(" at ");
+      Serial.println(actTime - start);
     }
   }  
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
   Serial.println("END OF TEST\n");
 }
 
@@ -444,4 +461,417 @@ void test_CircularArray() {
 }
 
 
+/******************************************************************************************************************************
+* Test the MidiClock (slave mode): replay a recorded jittery MIDI clock stream (120 BPM = 20.833 ms per clock) and check
+* that the predicted time of each next clock (the time a note would be played) is within 2 ms of the exact time when
+* locked. From clock 0 on (provisional period, the song's tempo is 10% off) the error must stay within 5 ms.
+*******************************************************************************************************************************/
+void test_MidiClock() {
+  Serial.println("\nSTART OF TEST");
+  /* jitter (ms) per received clock, as measured while the LED panel was updated every 20 ms */
+  int8_t jitter[] = {  1, 1,-2, 0, 2, 1, 1, 0, 1, 0, 0, 2,-1, 0,-1,-1, 0, 2,-1, 0,-1,-1, 0, 1,
+                       2,-1, 0, 1, 0, 0, 2, 1, 1, 2, 0,-2, 2,-2,-1, 1,-2, 1, 0, 0, 0,-1, 0, 0 };
+  uint32_t periodMicros = 20833;
+  uint32_t startMillis = 1000;
+  int maxError = 0;
+  int maxLockingError = 0;
+  MidiClock clock(&midi);
+  clock.mode = MIDI_CLOCK_SLAVE;
+  clock.setNominalTempo(550);          /* song's tempo: 10% slower than the external clock */
+  clock.receiveRealTime(MidiType::Start, startMillis);
+  for (uint32_t i = 0; i < 480; i++) {   /* 20 quarter notes */
+    uint32_t exact = startMillis + (i * periodMicros + 500) / 1000;
+    if (clock.isFollowing()) {
+      int error = abs((int)clock.getMillisAtClock(i) - (int)exact);  /* predicted before clock 'i' is received */
+      if (clock.isLocked()) maxError = max(maxError, error);
+      else maxLockingError = max(maxLockingError, error);
+    }
+    clock.receiveRealTime(MidiType::Clock, startMillis + (i * periodMicros) / 1000 + jitter[i % sizeof(jitter)]);
+  }
+  Serial.print("Tempo (ms per quarter note, about 500?): "); Serial.println(clock.getTempo());
+  Serial.print("Max error (ms): "); Serial.println(maxError);
+  Serial.print("Max error while locking (ms): "); Serial.println(maxLockingError);
+  Serial.println(maxError <= 2 && maxLockingError <= 5 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the leads of Playback (PLAYBACK_LOOK_AHEAD): with the LED lead longer than the MIDI lead, a note is started on the
+* LED panel first and sent to the piano later. The MIDI note-on must not be sent before 'start - midiLead', and each
+* started note must be sent. Plays the first 3 seconds of the song (auto-play on: the piano plays along).
+* Beware: song must be loaded before calling this function!
+*******************************************************************************************************************************/
+class TestLeadPlayer : public Playback<TestLeadPlayer, PLAYBACK_LOOK_AHEAD> {
+  friend class Playback<TestLeadPlayer, PLAYBACK_LOOK_AHEAD>;   /* calls _startNote() */
+  public:
+    TestLeadPlayer(MidiInterface* mi) : Playback(mi, NULL, NULL, NULL) {}
+    int errors = 0;
+    int started = 0;
+    int sent = 0;
+    void startSong(Song* song) {
+      _startTimeline(song, 0, PLAY_WHILE_PRACTICE_VOLU_1, 100, false, millis() + 500);
+      _timeAhead = 200;
+    }
+    void handlePlaying() {
+      uint32_t nowCorr = millis();
+      UpcomingNote* pending[UPCOMING_NOTES_MAX];  /* MIDI not sent yet (entries are not moved or cleared when removed) */
+      bool isEarly[UPCOMING_NOTES_MAX];
+      byte count = 0;
+      UpcomingNote* upcoming;
+      while (_scheduleNext(nowCorr)) ;
+      _upcomingArray.iterateInit(true);
+      while ( (upcoming = _upcomingArray.iterate()) != NULL) {
+        if (upcoming->midiDone) continue;
+        isEarly[count] = (_getStartMillis(upcoming) > nowCorr + _midiLead);
+        pending[count++] = upcoming;
+      }
+      _startDueNotes(nowCorr);
+      for (byte i = 0; i < count; i++) {
+        if (!pending[i]->midiDone) continue;
+        sent++;
+        if (isEarly[i]) errors++;   /* sent to the piano before 'start - midiLead' */
+      }
+      _handleSchedules(nowCorr);
+    }
+    void stopPlayingNow() { _stopTimeline(); }
+  private:
+    void _startNote(SongNote* note, uint32_t durationMillis, uint32_t nowCorr) { started++; }
+};
+
+void test_MidiLeadVsLedLead() {
+  Serial.println("\nSTART OF TEST");
+  int latencyMidi = Settings::latencyMidi;
+  int latencyLeds = Settings::latencyLeds;
+  Settings::latencyMidi = 5;
+  Settings::latencyLeds = 40;
+  TestLeadPlayer player(&midi);
+  player.startSong(&song);
+  uint32_t start = millis();
+  while (millis() - start < 3000 || (player.sent < player.started && millis() - start < 4000)) player.handlePlaying();
+  player.stopPlayingNow();
+  Settings::latencyMidi = latencyMidi;
+  Settings::latencyLeds = latencyLeds;
+  Serial.print("Notes started: "); Serial.print(player.started);
+  Serial.print(", sent to piano: "); Serial.println(player.sent);
+  Serial.print("Errors (sent too early): "); Serial.println(player.errors);
+  Serial.println(player.errors == 0 && player.started > 0 && player.sent == player.started ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the Compositor: top-most layer wins, transparent pixels show the layers below, and a change of 1 pixel only writes
+* 1 pixel of the LED panel.
+*******************************************************************************************************************************/
+void test_Compositor() {
+  Serial.println("\nSTART OF TEST");
+  int errors = 0;
+  Compositor<LAYER_COUNT> compositor(&ledPanel);
+  compositor.flatten();
+  if (compositor.pixelsFlattened != PANEL_LEDS) errors++;                          /* first time: whole panel */
+  compositor.setPixel(LAYER_NOTES, 10, 4, COLOR_IDX_BLUE);
+  compositor.setPixel(LAYER_CUES, 10, 4, COLOR_IDX_GREY);
+  compositor.flatten();
+  if (compositor.pixelsFlattened != 1) errors++;
+  if (ledPanel.getPixel(10, 4) != COLOR_IDX_GREY) errors++;                       /* cue on top of note */
+  compositor.setPixel(LAYER_CUES, 10, 4, LAYER_TRANSPARENT);
+  compositor.flatten();
+  if (ledPanel.getPixel(10, 4) != COLOR_IDX_BLUE) errors++;                       /* note below is shown again */
+  compositor.setPixel(LAYER_NOTES, 10, 4, COLOR_IDX_BLUE);                        /* no change */
+  if (compositor.flatten()) errors++;
+  compositor.setPixel(LAYER_NOTES, 2, 0, COLOR_IDX_RED);
+  compositor.setPixel(LAYER_NOTES, 4, 1, COLOR_IDX_RED);
+  compositor.flatten();
+  if (compositor.pixelsFlattened != 3 * 2) errors++;                              /* dirty rectangle: columns 2-4, rows 0-1 */
+  compositor.writeText(LAYER_OVERLAY, "8", 2, COLOR_IDX_YELLOW);
+  compositor.setLayerVisible(LAYER_OVERLAY, false);
+  compositor.flatten();
+  if (ledPanel.getPixel(2, 0) != COLOR_IDX_RED) errors++;                         /* hidden layer is not shown */
+  ledPanel.clear();
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the TextStrip: scrolling the pre-rendered strip must give the same LED panel as writing the text with writeText()
+* at each position (also when the strip repeats itself).
+*******************************************************************************************************************************/
+void test_TextStrip() {
+  Serial.println("\nSTART OF TEST");
+  const char* txt1 = "USER";
+  const char* txt2 = "SONG 12: ABC-XYZ";
+  byte panel[PANEL_LEDS];
+  TextStrip strip;
+  int w1 = strip.addText(&ledPanel, txt1, COLOR_IDX_BLUE);
+  strip.addSpace(7);
+  int w2 = strip.addText(&ledPanel, txt2, COLOR_IDX_YELLOW);
+  strip.addSpace(7);
+  int errors = 0;
+  if (w1 != ledPanel.getTextWidth(txt1) || w2 != ledPanel.getTextWidth(txt2)) errors++;
+  for (int x = PANEL_COLS - 1; x > -2 * strip.width; x--) {
+    ledPanel.clear();
+    for (int xText = x; xText < PANEL_COLS; xText += strip.width) {
+      ledPanel.writeText(txt1, xText, COLOR_IDX_BLUE);
+      ledPanel.writeText(txt2, xText + w1 + 7, COLOR_IDX_YELLOW);
+    }
+    for (int i = 0; i < PANEL_LEDS; i++) panel[i] = ledPanel.getPixel(i / PANEL_ROWS, i % PANEL_ROWS);
+    ledPanel.clear();
+    strip.draw(&ledPanel, x);
+    for (int i = 0; i < PANEL_LEDS; i++) if (panel[i] != ledPanel.getPixel(i / PANEL_ROWS, i % PANEL_ROWS)) { errors++; break; }
+  }
+  ledPanel.clear();
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the order of the LEDs (LedStripOrder, generated from PANEL_COLS and PANEL_ROWS) against the wiring of the LED panel
+* (see LedPanel.cpp): each LED exactly once, strip 1 starts at the piano key most to the right and strip 2 at the one before,
+* then each strip goes down/up in a zig-zag: the next LED is in the next row of the same column, or in the same row of the
+* next piano key of the strip. Only the last LEDs of a strip may be padding. The row in each entry (row dimming, see Ws2812)
+* must be the row of the LED, also for padding. Does not need the LED panel. The same is checked at compile time (see
+* ledOrderIsValid in LedPanel.h), this test checks the table in flash.
+*******************************************************************************************************************************/
+void test_LedStripOrder() {
+  Serial.println("\nSTART OF TEST");
+  byte seen[PANEL_LEDS];
+  int errors = 0;
+  for (int i = 0; i < PANEL_LEDS; i++) seen[i] = 0;
+  for (int strip = 0; strip < LEDPANEL_STRIPS; strip++) {
+    int prevX = 0, prevY = 0;
+    bool isPadding = false;
+    for (int i = 0; i < LEDS_PER_STRIP; i++) {
+      uint16_t entry = LedStripOrder::order[i * LEDPANEL_STRIPS + strip];
+      int idx = entry & WS2812_INDEX_MASK;
+      if ((entry >> WS2812_ROW_SHIFT) != (i / PANEL_ROWS % 2 == 0 ? i % PANEL_ROWS : PANEL_ROWS - 1 - i % PANEL_ROWS)) errors++;
+      if (idx == LED_IDX_PADDING) { isPadding = true; continue; }
+      if (isPadding || idx >= PANEL_LEDS) { errors++; continue; }   /* padding only at the end of a strip */
+      seen[idx]++;
+      int x = idx / PANEL_ROWS;
+      int y = idx % PANEL_ROWS;
+      if (i == 0) { if (x != PANEL_COLS - 1 - strip || y != 0) errors++; }                  /* first LED */
+      else if (i % PANEL_ROWS == 0) { if (x != prevX - LEDPANEL_STRIPS || y != prevY) errors++; } /* next piano key */
+      else if (x != prevX || abs(y - prevY) != 1) errors++;                                   /* next row */
+      prevX = x; prevY = y;
+    }
+  }
+  for (int i = 0; i < PANEL_LEDS; i++) if (seen[i] != 1) errors++;
+  Serial.print("Piano keys: "); Serial.print(PANEL_COLS); Serial.print(", LEDs per strip: "); Serial.println(LEDS_PER_STRIP);
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the palette of the LED panel (LedPalette, generated at compile time): COLOR_IDX_OFF is off at all levels, dimming steps
+* (+1..7) are never brighter than the step before and a brightness level is never darker than the level below. White has
+* the brightness of the curve. Does not need the LED panel.
+*******************************************************************************************************************************/
+void test_LedPalette() {
+  Serial.println("\nSTART OF TEST");
+  int errors = 0;
+  for (int level = 0; level < PANEL_BRIGHTNESS_LEVELS; level++) {
+    const uint32_t* colors = LedPalette::colors + level * PANEL_COLORS;
+    if (colors[COLOR_IDX_WHITE] != ledColor(ledBrightnessCurve[level], ledBrightnessCurve[level], ledBrightnessCurve[level])) errors++;
+    for (int i = 0; i < PANEL_COLORS; i++) {
+      if (i < COLOR_IDX_WHITE && colors[i] != 0) errors++;
+      for (int shift = 8; shift <= 24; shift += 8) {
+        byte c = colors[i] >> shift;
+        if (i % 8 != 0 && c > (byte)(colors[i - 1] >> shift)) errors++;                     /* dimming step */
+        if (level > 0 && c < (byte)(colors[i - PANEL_COLORS] >> shift)) errors++;           /* level below */
+      }
+    }
+  }
+  Serial.print("Brightness levels: "); Serial.print(PANEL_BRIGHTNESS_LEVELS); Serial.print(", palette bytes: ");
+  Serial.println(sizeof(LedPalette::colors));
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the encoder of LedDma (does not need the LED panel): encode pairs of colors, replay the toggles slot by slot and
+* check each bit of both lines against the WS2812B timing (0: 0.4us HIGH + 0.85us LOW, 1: 0.8us HIGH + 0.45us LOW,
+* +/- 150 ns). The colors decoded from the bitstream must be the colors encoded.
+*******************************************************************************************************************************/
+#define TEST_WS2812_TOLERANCE 150
+void test_LedDmaEncoder() {
+  Serial.println("\nSTART OF TEST");
+  uint32_t colors[] = { 0x00000000, 0xFFFFFF00, 0x80000100, 0x55AA5500, 0x12345600, 0xFEDCBA00 };
+  byte mask[2] = { 0x04, 0x20 };
+  byte out[LEDDMA_BYTES_PER_LED];
+  int errors = 0;
+  for (int c = 0; c < (int)(sizeof(colors) / sizeof(colors[0])); c++) {
+    uint32_t color[2] = { colors[c], colors[(c + 1) % (sizeof(colors) / sizeof(colors[0]))] };
+    LedDma::encodeLed(color[0], color[1], mask[0], mask[1], out);
+    for (int line = 0; line < 2; line++) {
+      uint32_t decoded = 0;
+      bool level = false;                          /* line is LOW between LEDs */
+      for (int bit = 0; bit < 24; bit++) {
+        int high = 0, low = 0;
+        for (int slot = 0; slot < LEDDMA_SLOTS_PER_BIT; slot++) {
+          if (out[bit * LEDDMA_SLOTS_PER_BIT + slot] & mask[line]) level = !level;
+          if (level) { if (low > 0) errors++; high++; }   /* HIGH after LOW within 1 bit: wrong */
+          else low++;
+        }
+        int highNanos = high * LEDDMA_SLOT_NANOS;
+        int lowNanos = low * LEDDMA_SLOT_NANOS;
+        bool isOne = (highNanos > 600);
+        if (abs(highNanos - (isOne ? 800 : 400)) > TEST_WS2812_TOLERANCE) errors++;
+        if (abs(lowNanos - (isOne ? 450 : 850)) > TEST_WS2812_TOLERANCE) errors++;
+        decoded = (decoded << 1) | (isOne ? 1 : 0);
+      }
+      if ((decoded << 8) != color[line]) {
+        errors++;
+        Serial.print("Color sent: "); Serial.print(color[line], HEX); Serial.print(", decoded: "); Serial.println(decoded << 8, HEX);
+      }
+    }
+  }
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test the CapacityPlanner with a known song: at 100 QPM (x 1.8, CAPACITY_TEMPO_FACTOR) a quarter note is 333 ms, so the
+* look-ahead of 2100 ms is 756 ticks (resolution 120). A chord of 4 notes at tick 0 (1 of them held until tick 2000), then
+* 2 notes at tick 1000 and 1100: the chord is the worst case for sounding (4), upcoming (4) and glove commands (2 x 4).
+* Does not need a loaded song.
+*******************************************************************************************************************************/
+void test_CapacityPlanner() {
+  Serial.println("\nSTART OF TEST");
+  int errors = 0;
+  CapacityPlanner planner(120, 100);
+  if (planner.lookAheadTicks != 756) errors++;
+  for (int i = 0; i < 3; i++) planner.addNote(0, 240);
+  planner.addNote(0, 2000);
+  if (planner.capacity.sounding != 4 || planner.capacity.upcoming != 4 || planner.capacity.gloveCommands != 8) errors++;
+  planner.addNote(1000, 120);          /* look-ahead from tick 244: the 3 short notes have ended, the long one waits */
+  planner.addNote(1100, 100);          /* sounding 3, upcoming 2, glove commands 2 x 2 + 1: less than the chord */
+  if (planner.capacity.sounding != 4 || planner.capacity.upcoming != 4 || planner.capacity.gloveCommands != 8) errors++;
+  CapacityPlanner full(120, 100);      /* more notes than can be kept: glove commands are at least CAPACITY_NOTES_MAX */
+  for (int i = 0; i <= CAPACITY_NOTES_MAX; i++) full.addNote(i, 10000);
+  if (full.capacity.gloveCommands < CAPACITY_NOTES_MAX) errors++;
+  Serial.print("sounding: "); Serial.print(planner.capacity.sounding);
+  Serial.print(", upcoming: "); Serial.print(planner.capacity.upcoming);
+  Serial.print(", glove commands: "); Serial.println(planner.capacity.gloveCommands);
+  Serial.print("Errors: "); Serial.println(errors);
+  Serial.println(errors == 0 ? "OK" : "FAILED");
+  Serial.println("END OF TEST\n");
+}
+
+
+/******************************************************************************************************************************
+* Test: latency from key press to LED panel, for practice 1, 2 and 3. Key presses are injected in MidiInterface (as if
+* received on Serial1, needs MIDI_INJECT in HardwDefs.h), the LatencyProbe timestamps RX, frame compose and end of
+* writeLeds_asm().
+*  practice 1: keys of the current step are pressed, latency until the next step is shown
+*  practice 2: a key is pressed in start-up mode, latency until row 4 shows the first note(s)
+*  practice 3: no key, the system sets the pace: latency from a note that is due (row 4 changed) until the next frame
+* Only the timing is measured here: the arithmetic of the probe (deltas, overflows, percentiles) is checked on the host
+* by tools/LatencyProbeHost.
+* Beware: song must be loaded before calling this function!
+*******************************************************************************************************************************/
+void test_KeyToLedLatency() {
+  Serial.println("\nSTART OF TEST");
+  byte clockMode = midiClock.mode;
+  midiClock.mode = MIDI_CLOCK_OFF;       /* practice 2 must start with a piano key */
+  midi.setLatencyProbe(&latencyProbe);
+  ledPanel.setLatencyProbe(&latencyProbe);
+  for (byte practice = PRACTICE_1; practice <= PRACTICE_3; practice++) {
+    latencyProbe.start();
+#ifdef MIDI_INJECT
+    if (practice == PRACTICE_1) test_KeyToLedLatency_1();
+    if (practice == PRACTICE_2) test_KeyToLedLatency_2();
+#else
+    if (practice != PRACTICE_3) Serial.println("SKIPPED: needs MIDI_INJECT (HardwDefs.h)");
+#endif
+    if (practice == PRACTICE_3) test_KeyToLedLatency_3();
+    latencyProbe.stop();
+    uint16_t compose[PROBE_PERCENTILES], shown[PROBE_PERCENTILES];
+    latencyProbe.getPercentiles(false, compose);
+    latencyProbe.getPercentiles(true, shown);
+    Serial.print("Practice "); Serial.print(practice);
+    Serial.print(": samples: "); Serial.print(latencyProbe.count);
+    Serial.print(", overflows: "); Serial.println(latencyProbe.overflows);
+    Serial.print("  compose p50/p99/max (us): "); 
+    Serial.print(compose[0]); Serial.print(" / "); Serial.print(compose[1]); Serial.print(" / "); Serial.println(compose[2]);
+    Serial.print("  shown   p50/p99/max (us): ");
+    Serial.print(shown[0]); Serial.print(" / "); Serial.print(shown[1]); Serial.print(" / "); Serial.println(shown[2]);
+  }
+  midi.setLatencyProbe(NULL);
+  ledPanel.setLatencyProbe(NULL);
+  midiClock.mode = clockMode;
+  Serial.println("END OF TEST\n");
+}
+
+#ifdef MIDI_INJECT
+/* inject NoteOn message (as if piano key was pressed) */
+void test_injectKey(byte pitch) {
+  midi.injectByte(MidiType::NoteOn);
+  midi.injectByte(pitch);
+  midi.injectByte(64);
+}
+
+void test_KeyToLedLatency_1() {
+  Player1 player(&midi, &ledPanel, &gloves, &frameScheduler);
+  player.startSong(&song, 1, false, 5, true /* repeat */);
+  int idx = song.getMeasureStartIndex(1);
+  while (latencyProbe.count < PROBE_SAMPLES_MAX) {
+    /* press all keys of the current step (notes at the same tick, max 10 keys) */
+    while (song.notes[idx].type != TYPE_NOTE) idx = (idx + 1) % song.noteCount;
+    uint32_t tick = song.notes[idx].atTick;
+    int keys = 0;
+    while (song.notes[idx].atTick == tick) {
+      if (song.notes[idx].type == TYPE_NOTE && keys++ < 10) test_injectKey(song.notes[idx].pitch);
+      idx = (idx + 1) % song.noteCount;
+      if (idx == 0) break;
+    }
+    uint16_t countBefore = latencyProbe.count;
+    uint32_t start = millis();
+    while (latencyProbe.count == countBefore && millis() - start <= 500) player.handlePlaying();
+    if (latencyProbe.count == countBefore) { Serial.println("FAILED: next step not shown"); break; }
+    delay(random(5, 30));
+  }
+  player.stopPlayingNow();
+}
+
+void test_KeyToLedLatency_2() {
+  Player2 player(&ledPanel, &metronome, &midi, &gloves, &midiClock);
+  while (latencyProbe.count < PROBE_SAMPLES_MAX) {
+    player.startSong(&song, 1, false, PLAY_WHILE_PRACTICE_OFF, 100, false);
+    uint32_t start = millis();
+    uint32_t wait = random(5, 30);
+    while (millis() - start < wait) player.handlePlaying();  /* start-up mode: waiting for key */
+    test_injectKey(MIDI_PITCH_MIN);
+    uint16_t countBefore = latencyProbe.count;
+    start = millis();
+    while (latencyProbe.count == countBefore && millis() - start <= 500) player.handlePlaying();
+    player.stopPlayingNow();
+    if (latencyProbe.count == countBefore) { Serial.println("FAILED: first note not shown"); break; }
+  }
+}
+#endif // MIDI_INJECT
+
+void test_KeyToLedLatency_3() {
+  Player3 player(&ledPanel, &metronome, &midi, &gloves, &midiClock);
+  player.setLatencyProbe(&latencyProbe);   /* each note on row 4 is timestamped */
+  player.startSong(&song, 1, false, PLAY_WHILE_PRACTICE_OFF, 100, 0, true /* repeat */);
+  while (latencyProbe.count < PROBE_SAMPLES_MAX) {
+    uint16_t countBefore = latencyProbe.count;
+    uint32_t start = millis();
+    while (latencyProbe.count == countBefore && millis() - start <= 5000) player.handlePlaying();  /* until next note shown */
+    if (latencyProbe.count == countBefore) { Serial.println("FAILED: no note shown"); break; }
+  }
+  player.stopPlayingNow();
+}
+
 #endif // DEBUG_MODE
@@ -6,10 +6,11 @@
 /******************************************************************************************************************************
 * Constructor
 *******************************************************************************************************************************/
-Player1::Player1(MidiInterface* mi, LedPanel* lp, Gloves* g) {
+Player1::Player1(MidiInterface* mi, LedPanel* lp, Gloves* g, FrameScheduler* fs) : _compositor(lp) {
   _ledPanel  = lp;
   _midi      = mi;
   _gloves    = g;
+  _frames    = fs;
 }
 
 
@@ -27,9 +28,14 @@ void Player1::startSong(Song* song, int startMeasureNr, bool withGloves, byte pa
   curMeasureNr = startMeasureNr;
   _curNoteIdx = song->getMeasureStartIndex(startMeasureNr); 
   _moveToFirstNote();                   /* let _curNoteIdx refer to first real Note (not Measure) */
-  _registerPianoKeysCurrentPosition();  /* 1 bit for each key (user should press) before proceed to next position */
+  _nextStep.noteIdx = _curNoteIdx;      /* first step */
+  _nextStep.measureNr = curMeasureNr;
+  _registerPianoKeys(&_nextStep);       /* 1 bit for each key (user should press) before proceed to next position */
+  _drawLEDpanel(&_nextStep);
   _gloves->reset(withGloves);
-  _drawLEDpanel();
+  _compositor.clear();                  /* LED panel may show anything (e.g. start screen): all LEDs are written */
+  _showStep(&_nextStep);
+  _isNextStepReady = false;
   isPlaying = true;
 }
 
@@ -44,20 +50,22 @@ void Player1::handlePlaying() {
   do {
     pitch = _midi->getPressedPianoKey(); /* zero if no piano key was pressed */
     if (pitch >= MIDI_PITCH_MIN && pitch <= MIDI_PITCH_MAX) {
-      _ledPanel->setPixel(pitch - MIDI_PITCH_MIN, 4, COLOR_IDX_OFF); /* set LED off */    
+      _compositor.setPixel(LAYER_NOTES, pitch - MIDI_PITCH_MIN, 4, COLOR_IDX_OFF); /* set LED off: feedback for each key */
       done = _pianoKeyRemove(pitch);
     }
   } while (pitch != 0);       /* loop, 'cause more piano keys may be pressed simultaniously */
   
   if (done) {              /* all neccessary keys have been pressed: go to next step!  */
-    _moveToNoteAtNewTick();
-    _registerPianoKeysCurrentPosition();
-    /* NOTE: Updating the LED panel (writeLeds_asm()) cannot be combined by reading piano keys (using 'Serial1' object).
-     *       This is because 'writeLeds_asm()' DISABLES INTERRUPTS temporarily, while 'Serial1' NEEDS INTERRUPTS for reading data.
-     *       So the LED panel is only updated (see below) after ALL neccessary piano keys have been pressed.
-     *       More frequent updates (e.g. after each key) will result in missing bytes by 'Serial1' (thus missing pressed piano keys).   */
-    _drawLEDpanel();
+    if (!_isNextStepReady) _prepareNextStep();  /* keys were pressed before an idle loop could prepare it */
+    _showStep(&_nextStep);
+    _isNextStepReady = false;
   }
+  /* NOTE: Updating the LED panel (writeLeds_asm()) DISABLES INTERRUPTS temporarily, while 'Serial1' NEEDS INTERRUPTS for
+   *       reading data. The frame scheduler only writes the LED panel when no MIDI message is being received.  */
+  if (_compositor.flatten()) _frames->requestFrame();  /* only changed pixels are written to the LED-matrix */
+  _frames->handleFrame();
+  /* Idle (waiting for piano keys, no frame to write): prepare the next step, so it is shown without delay */
+  if (!_isNextStepReady && !_frames->isPending && !_songFinished) _prepareNextStep();
 }
 
 void Player1::_moveToFirstNote() {
@@ -74,37 +82,51 @@ void Player1::_moveToFirstNote() {
   }
 }
 
-void Player1::_moveToNoteAtNewTick() {
-  SongNote* note = &_notes[_curNoteIdx];
-  SongMeasure* measure;   /* we must update 'curMeasureNr' when we come accross a measure */
+/******************************************************************************************************************************
+* The next step is prepared ahead (while the user is playing the current step): when the right piano keys have been pressed,
+* only the prepared LED panel layers are copied and the LEDs can be written at once.
+*******************************************************************************************************************************/
+void Player1::_prepareNextStep() {
+  _nextStep.noteIdx = _curNoteIdx;
+  _nextStep.measureNr = curMeasureNr;
+  _moveToNoteAtNewTick(&_nextStep);
+  _registerPianoKeys(&_nextStep);
+  _drawLEDpanel(&_nextStep);
+  _isNextStepReady = true;
+}
+
+
+void Player1::_moveToNoteAtNewTick(Step* step) {
+  SongNote* note = &_notes[step->noteIdx];
+  SongMeasure* measure;   /* we must update 'measureNr' when we come accross a measure */
   uint32_t oldTickPos = note->atTick;
   uint32_t newTickPos;
 
   do {
-    _curNoteIdx++;
-    if (_curNoteIdx == _noteCount) { /* end of song reached... */
+    step->noteIdx++;
+    if (step->noteIdx == _noteCount) { /* end of song reached... */
       if (_doRepeat) {
-        _curNoteIdx = 0; /* repeat: start over again... */
+        step->noteIdx = 0; /* repeat: start over again... */
       }
       else {
-        _songFinished = true;
         return;    /* end reached with no repeat */
       }
     }
-    note = &_notes[_curNoteIdx];
+    note = &_notes[step->noteIdx];
     newTickPos = note->atTick;
-    if (note->type != TYPE_NOTE) { /* it's a measure, thus we must update 'curMeasureNr' */
+    if (note->type != TYPE_NOTE) { /* it's a measure, thus we must update 'measureNr' */
       measure = (SongMeasure*)note;
-      curMeasureNr = measure->measureNr;   /* update 'curMeasureNr' */
+      step->measureNr = measure->measureNr;   /* update 'measureNr' */
     }
   } while (newTickPos == oldTickPos || note->type != TYPE_NOTE);
 }
 
 
-void Player1::_drawLEDpanel() {
-  _ledPanel->clear();
-  _gloves->clearAllFingers();
-  int noteIdx = _curNoteIdx;
+void Player1::_drawLEDpanel(Step* step) {
+  memset(step->notes, LAYER_TRANSPARENT, PANEL_LEDS);
+  memset(step->cues, LAYER_TRANSPARENT, PANEL_LEDS);
+  step->fingers = 0;
+  int noteIdx = step->noteIdx;
   if (noteIdx < _noteCount) {  /* not yet end reached ? */
     for (int row = 4; row >= 0; row--) { /* notes on row 4 of LED-panel must be played first, row 3 thereafter, etc.  */
       SongNote* note = &_notes[noteIdx];
@@ -119,7 +141,7 @@ void Player1::_drawLEDpanel() {
           case TYPE_MEASURE_BM:
             if (row == 4) { /* a measure here? Then actually starts with the next measure.. */
               measure = (SongMeasure*)note;
-              curMeasureNr = measure->measureNr; /* curMeasureNr is needed when user navigates through song with foot pedals */
+              step->measureNr = measure->measureNr; /* curMeasureNr is needed when user navigates through song with foot pedals */
             }
             break;
           case TYPE_NOTE:
@@ -131,13 +153,15 @@ void Player1::_drawLEDpanel() {
             byte color = _colorIdx_fingers[note->finger];     /* color for the finger to play */
 
             if ( _panelRowsUsed >= (5 - row) ) { /* bottom row is always used (displays what to play NOW), other rows depend on setting  */
-              _ledPanel->setPixel(note->pitch - MIDI_PITCH_MIN, row, color); /* set LED on */                
+              int led = (note->pitch - MIDI_PITCH_MIN) * PANEL_ROWS + row;    /* same layout as Compositor */
+              step->notes[led] = color; /* set LED on */                
+              step->cues[led] = LAYER_TRANSPARENT;  /* a note is never hidden by a cue (e.g. the same key is played again) */
               if (row > 0 && User::leftHandCue && note->isFingerLeft()) { /* should indication for left hand note be shown? */
-                _ledPanel->setPixel(note->pitch - MIDI_PITCH_MIN, row - 1, COLOR_IDX_GREY + 7);  /* grey LED above means: should be played with left hand */
+                step->cues[led - 1] = COLOR_IDX_GREY + 7;  /* grey LED above means: should be played with left hand */
               }
             }
             if (row == 4) { /* row 4 represents notes that should be played NOW */
-              _gloves->setFinger(note->finger, true);
+              step->fingers |= (1 << note->finger);
             }
             break;
         }
@@ -153,8 +177,22 @@ void Player1::_drawLEDpanel() {
       if (noteIdx == _noteCount) break;   /* end reached with no repeat  */
     }
   }
+}
+
+
+void Player1::_showStep(Step* step) {
+  _curNoteIdx = step->noteIdx;
+  curMeasureNr = step->measureNr;
+  _songFinished = (step->noteIdx == _noteCount);
+  memcpy(_bitPerPianoKey, step->pianoKeys, sizeof(_bitPerPianoKey));
+  _compositor.setLayer(LAYER_NOTES, step->notes);
+  _compositor.setLayer(LAYER_CUES, step->cues);
   // _drawMeasureNr(); /* uncomment to display current measureNr on LED panel (experimental feature!) */ 
-  _ledPanel->writeLeds_asm(); /* display the changed LED-matrix  */
+  /* the changed LED-matrix is displayed in handlePlaying() */
+  _gloves->clearAllFingers();
+  for (int finger = 0; finger <= MAX_FINGER_INDEX; finger++) {
+    if (step->fingers & (1 << finger)) _gloves->setFinger(finger, true);
+  }
   _gloves->updateGloves();
 }
 
@@ -165,6 +203,7 @@ void Player1::_drawLEDpanel() {
 void Player1::_drawMeasureNr() {
   static bool lastWasLeft = true;  /* try left side first, keep at choosen side for as long as possible */
   static char charBuf[4];          /* for measureNr in text */
+  _compositor.clearLayer(LAYER_OVERLAY);
   itoa(curMeasureNr, charBuf, 10); /* convert measureNr to text */ 
   int w = _ledPanel->getTextWidth(charBuf); /* the width of the text in pixels/LEDs  */
   int x2 = PANEL_COLS - 1; /* the very left column of the LED panel */
@@ -172,24 +211,24 @@ void Player1::_drawMeasureNr() {
   bool canRight = true; /* possible to put measureNr at right side? */
   /* below: check if there is space on the LED panel at the left and right side... */
   for (int x = 0; x <= w; x++) { /* check for w+1 columns (1 column margin) */
-    canLeft  &= _ledPanel->IsColumnEmpty(x);
-    canRight &= _ledPanel->IsColumnEmpty(x2--);
+    canLeft  &= _compositor.isColumnEmpty(x);
+    canRight &= _compositor.isColumnEmpty(x2--);
   }
   if (!(canLeft || canRight)) return; /* there is no place to put measureNr on LED panel! */
   if (lastWasLeft  && !canLeft ) lastWasLeft = false; /* switch placement to right side */
   if (!lastWasLeft && !canRight) lastWasLeft = true;  /* switch placement to left side */
   /* write measure-nr to LED panel:  */
-  _ledPanel->writeText(charBuf, lastWasLeft ? 0 : (PANEL_COLS - w), COLOR_IDX_YELLOW);
+  _compositor.writeText(LAYER_OVERLAY, charBuf, lastWasLeft ? 0 : (PANEL_COLS - w), COLOR_IDX_YELLOW);
 }
 
 
 
 
 
-void Player1::_registerPianoKeysCurrentPosition() {
-  _pianoKeyReset();
-  if (_curNoteIdx == _noteCount) return; /* end reached, no repeat */
-  int noteIdx = _curNoteIdx;
+void Player1::_registerPianoKeys(Step* step) {
+  memset(step->pianoKeys, 0, sizeof(step->pianoKeys));
+  if (step->noteIdx == _noteCount) return; /* end reached, no repeat */
+  int noteIdx = step->noteIdx;
   SongNote* note = &_notes[noteIdx];
   bool tickPosFound = false;
   uint32_t tickPos; // = note->atTick;
@@ -199,7 +238,7 @@ void Player1::_registerPianoKeysCurrentPosition() {
         tickPos = note->atTick; 
         tickPosFound = true; 
       }
-      _pianoKeyRegister(note->pitch);
+      _pianoKeyRegister(step->pianoKeys, note->pitch);
     }
     noteIdx++;
     if (noteIdx == _noteCount) noteIdx = 0; /* repeat: start over again... */
@@ -211,21 +250,14 @@ void Player1::_registerPianoKeysCurrentPosition() {
 
 
 
-void Player1::_pianoKeyReset() {
-  _bitPerPianoKey[0] = 0;
-  _bitPerPianoKey[1] = 0;
-  _bitPerPianoKey[2] = 0;
-}
-
-
-void Player1::_pianoKeyRegister(int pitch) {
+void Player1::_pianoKeyRegister(uint32_t* pianoKeys, int pitch) {
   pitch -= MIDI_PITCH_MIN;
   if (pitch < 32)
-    _bitPerPianoKey[0] |= (1UL << (pitch));
+    pianoKeys[0] |= (1UL << (pitch));
   else if (pitch < 64)
-    _bitPerPianoKey[1] |= (1UL << (pitch-32));
+    pianoKeys[1] |= (1UL << (pitch-32));
   else
-    _bitPerPianoKey[2] |= (1UL << (pitch-64));
+    pianoKeys[2] |= (1UL << (pitch-64));
 }
 
 bool Player1::_pianoKeyRemove(int pitch) {
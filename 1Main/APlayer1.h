@@ -7,6 +7,8 @@
 #include "LedPanel.h"
 #include "Gloves.h"
 #include "Midi.h"
+#include "FrameScheduler.h"
+#include "Compositor.h"
 
 
 /*
@@ -15,7 +17,7 @@
 */
 class Player1 {
   public:
-    Player1(MidiInterface* mi, LedPanel* lp, Gloves* g);
+    Player1(MidiInterface* mi, LedPanel* lp, Gloves* g, FrameScheduler* fs);
 
     /* playing the song */
     void startSong(Song* song, int startMeasureNr, bool withGloves, byte panelRowsUsed, bool repeat);
@@ -29,6 +31,17 @@ class Player1 {
   protected:
 
   private:
+    /* NESTED CLASS: a step of the song (notes at the same tick) as it is shown: LED panel layers, keys to press, fingers */
+    class Step {
+      public:
+        int noteIdx;                 /* index of first note of the step, _noteCount: end of song (no repeat) */
+        int measureNr;               /* curMeasureNr while the step is shown */
+        uint32_t pianoKeys[3];       /* 1 bit per piano key that should be pressed (see _pianoKeyRegister) */
+        uint16_t fingers;            /* 1 bit per finger (glove) of row 4 */
+        byte notes[PANEL_LEDS];      /* LAYER_NOTES (this step on row 4, the next ones on row 3/2/1/0) */
+        byte cues[PANEL_LEDS];       /* LAYER_CUES */
+    };
+
     /* basic song info (copied from Song object) */
     int       _noteCount;          /* how many of MAX_NOTES elements used? */
     SongNote* _notes;              /* notes within song */
@@ -37,6 +50,8 @@ class Player1 {
     MidiInterface* _midi;
     LedPanel*      _ledPanel;
     Gloves*        _gloves;
+    FrameScheduler* _frames;
+    Compositor<LAYER_OVERLAY + 1> _compositor;  /* layers: notes, left hand cues, measure number */
 
     /* playing the song */
     int _curNoteIdx;        /* index of current note */
@@ -44,15 +59,19 @@ class Player1 {
     bool _doRepeat;         /*  repeat after end of song? */
     bool _songFinished;
 
+    Step _nextStep;         /* prepared while waiting for piano keys, shown as soon as the current step is played */
+    bool _isNextStepReady;
+
     void _moveToFirstNote();     /* when start playing.. */
-    void _moveToNoteAtNewTick(); /* after the right piano keys have been pressed */
-    void _registerPianoKeysCurrentPosition();
-    void _drawLEDpanel();
+    void _prepareNextStep();     /* the step after the current step, in _nextStep */
+    void _moveToNoteAtNewTick(Step* step); /* step->noteIdx to the next tick with notes */
+    void _registerPianoKeys(Step* step);
+    void _drawLEDpanel(Step* step);
+    void _showStep(Step* step);  /* step becomes the current step: LED panel layers, piano keys, gloves */
     void _drawMeasureNr();
     
     uint32_t _bitPerPianoKey[3];
-    void _pianoKeyReset();
-    void _pianoKeyRegister(int pitch);
+    void _pianoKeyRegister(uint32_t* pianoKeys, int pitch);
     bool _pianoKeyRemove(int pitch);
 };
 
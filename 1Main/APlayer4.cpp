@@ -8,7 +8,7 @@
 /******************************************************************************************************************************
 * Constructor for playing song
 *******************************************************************************************************************************/
-Player4::Player4(MidiInterface* mi, LedPanel* lp) {
+Player4::Player4(MidiInterface* mi, LedPanel* lp) : _compositor(lp) {
   _ledPanel  = lp;
   _midi      = mi;
   _measuresPracticed = 0; /* increases when user completes a measure */
@@ -30,6 +30,7 @@ void Player4::startSong(Song* song, int startMeasureNr, byte midiPlay) {
   _startMeasure(startMeasureNr);
   _prepareStepAndMoveToNext();  /* 1 bit for each key (user should press) before proceed to next position */
   _sustainDown = false;
+  _compositor.clear();          /* LED panel may show anything: all LEDs are written */
   _drawLEDpanel(true);
   isPlaying = true;
 }
@@ -202,7 +203,9 @@ void Player4::_drawLEDpanel(bool newMeasure) {
 
   if (_sustainDown) /* when sustain is down -> show the notes to play (peek) */
   {
-    _ledPanel->clear();
+    _compositor.clearLayer(LAYER_NOTES);
+    _compositor.setLayerVisible(LAYER_OVERLAY, false);  /* only the notes to play are shown */
+    _compositor.setLayerVisible(LAYER_STATUS, false);
 
     for (int i=0; i < MAX_KEYS_IN_STEP; i++) {
       uint16_t pitch = _keysCurrStepCopy[i]; 
@@ -212,27 +215,31 @@ void Player4::_drawLEDpanel(bool newMeasure) {
       pitch = (pitch & 0xff);  /* remove finger number from pitch */
       uint16_t x = pitch - MIDI_PITCH_MIN; /* convert MIDI pitch to LED panel column, so that pitch 0 is the very left piano key */
       byte color = _colorIdx_fingers[finger];     /* color for the finger to play */
-      _ledPanel->fillRect(x, 1, x, 4, color);
+      for (int y = 1; y <= 4; y++) _compositor.setPixel(LAYER_NOTES, x, y, color);
       if (SongNote::isFingerLeft(finger)) { /* is this note to played with left hand? */
-        _ledPanel->setPixel(x, 0, COLOR_IDX_GREY + 7);  /* grey LED on top means: should be played with left hand */
+        _compositor.setPixel(LAYER_NOTES, x, 0, COLOR_IDX_GREY + 7);  /* grey LED on top means: should be played with left hand */
       }
 
     }
+    _compositor.flatten();
     _ledPanel->writeLeds_asm(); /* display the changed LED-matrix  */
     return;  /* while sustain pedal is down, only the above code is needed */
   }
   
+  _compositor.setLayerVisible(LAYER_OVERLAY, true);
+  _compositor.setLayerVisible(LAYER_STATUS, true);
   if (newMeasure) {
-    _ledPanel->clear();
+    _compositor.clearLayer(LAYER_NOTES);
+    _compositor.clearLayer(LAYER_OVERLAY);
     /* initial drawing at the start of a new measure */
     itoa(curMeasureNr, charBuf, 10);
-    _ledPanel->writeText(charBuf, 25 + PANEL_LEFT_MARGIN, COLOR_IDX_YELLOW); /* write measure-nr */
+    _compositor.writeText(LAYER_OVERLAY, charBuf, 25 + PANEL_LEFT_MARGIN, COLOR_IDX_YELLOW); /* write measure-nr */
     /* Steps on the X-axis, notes per step on the Y-axis */
     for (int s=0; s < _stepCount; s++) {
       for (int y=0; y< _notesPerStep[s]; y++) {
         if (y >= 5) continue; /* LED-panel has only 5 rows of LEDs*/
         int x = LED_PANEL_X_FIRST_STEP + s;
-        _ledPanel->setPixel(x + PANEL_LEFT_MARGIN, y /* row */ , COLOR_IDX_WHITE + 5 /* dimmed grey */);
+        _compositor.setPixel(LAYER_NOTES, x + PANEL_LEFT_MARGIN, y /* row */ , COLOR_IDX_WHITE + 5 /* dimmed grey */);
       }
     }
   }
@@ -242,15 +249,16 @@ void Player4::_drawLEDpanel(bool newMeasure) {
       int x = LED_PANEL_X_FIRST_STEP + s;
       byte color =  (s < _stepIndex ? COLOR_IDX_GREEN : COLOR_IDX_YELLOW);
       if (s < _stepIndex && _errorPerStep[s]) color = COLOR_IDX_RED;
-      _ledPanel->setPixel(x + PANEL_LEFT_MARGIN, y /* row */ , color);
+      _compositor.setPixel(LAYER_NOTES, x + PANEL_LEFT_MARGIN, y /* row */ , color);
     }
   }
   /* draw accomplishments (red or green pixel per completed measure) */
   for (int i = 0; i< _measuresPracticed; i++) {
     int y = i % 5; /* LED panel row (0,1,2,3,4) */
     int x = i / 5; /* LED panel column */
-    _ledPanel->setPixel(x + PANEL_LEFT_MARGIN, y, _practiceResults[i] ? COLOR_IDX_GREEN : COLOR_IDX_RED);  
+    _compositor.setPixel(LAYER_STATUS, x + PANEL_LEFT_MARGIN, y, _practiceResults[i] ? COLOR_IDX_GREEN : COLOR_IDX_RED);  
   } 
+  _compositor.flatten();      /* only the pixels that changed are copied to the LED-matrix */
   _ledPanel->writeLeds_asm(); /* display the changed LED-matrix  */
 }
 
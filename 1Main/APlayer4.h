@@ -6,6 +6,7 @@
 #include "Entities.h"
 #include "LedPanel.h"
 #include "Midi.h"
+#include "Compositor.h"
 
 
 #define LED_PANEL_X_FIRST_STEP 41      /* column/x-position on LED-panel from where steps are drawn */
@@ -43,6 +44,7 @@ class Player4 {
     /* references to needed objects */
     MidiInterface* _midi;
     LedPanel*      _ledPanel;
+    Compositor<LAYER_STATUS + 1> _compositor;  /* layers: steps (or peeked notes), measure number, accomplishments */
 
     /* playing the song */
     int _curNoteIdx;        /* index of current note */
@@ -148,7 +148,6 @@ void Player5::_registerPianoKeysCurrentPosition() {
 *******************************************************************************************************************************/
 void Player5::_drawNoteLetters() {
   static char notes[]  = "C C#D D#E F F#G G#A A#B ";
-  static char widths[] = "445544444555"; /* widths in pixels of letters CCDDEFFGGAAB */
   const uint8_t PHASE_MEASURE = 0; /* firstly, only measure size in pixels/LEDcolumns */
   const uint8_t PHASE_DRAW = 1;    /* secondly, do the drawing, so it can be centered */
   const uint8_t PHASE_FINISHED = 2;
@@ -203,14 +202,13 @@ void Player5::_drawNoteLetters() {
       if (phase == PHASE_DRAW) {
         _ledPanel->writeChar(notes[pitch*2], x, color ); /* Note letter, like C,D,E,F,G,A,B */
       }
-      uint8_t w = widths[pitch] - '0';
-      x += (w + 1); /* width of letter + 1 pixel spacing */
+      x += (_ledPanel->getCharWidth(notes[pitch*2]) + 1); /* width of letter (glyph cache) + 1 pixel spacing */
       if (notes[pitch*2+1] == '#')
       {
         if (phase == PHASE_DRAW) {
           _ledPanel->writeChar('#', x, color ); /* sharp symbol (#) to indicate black piano key */
         }
-        x += (5 + 1); /* width of '#' symbol + 1 pixel spacing */
+        x += (_ledPanel->getCharWidth('#') + 1); /* width of '#' symbol + 1 pixel spacing */
       }
       formerFinger = finger;
     }
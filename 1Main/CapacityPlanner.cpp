@@ -0,0 +1,55 @@
+#include "CapacityPlanner.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  CapacityPlanner
+*
+*******************************************************************************************************************************/
+
+
+CapacityPlanner::CapacityPlanner(uint32_t resolution, uint16_t tempoQPM) {
+  if (tempoQPM == 0) tempoQPM = 1;
+  uint32_t tempo = 6000000 / ((uint32_t)tempoQPM * CAPACITY_TEMPO_FACTOR);  /* ms per quarter note, same as the players */
+  if (tempo == 0) tempo = 1;
+  lookAheadTicks = (uint32_t)CAPACITY_LOOK_AHEAD_MILLIS * resolution / tempo;
+  capacity.sounding = 0;
+  capacity.upcoming = 0;
+  capacity.gloveCommands = 0;
+  _count = 0;
+}
+
+
+void CapacityPlanner::addNote(uint32_t atTick, uint32_t duration) {
+  int32_t t = (int32_t)atTick - (int32_t)lookAheadTicks;   /* look-ahead time before this note (negative: song start) */
+  int i = 0;
+  while (i < _count) {                 /* notes that started and ended before 't' do not matter anymore */
+    if ((int32_t)_starts[i] <= t && (int32_t)_ends[i] <= t) {
+      _count--;
+      _starts[i] = _starts[_count];
+      _ends[i] = _ends[_count];
+    }
+    else i++;
+  }
+  if (_count == CAPACITY_NOTES_MAX) {  /* each note that is kept has at least 1 glove command waiting */
+    if (capacity.gloveCommands < CAPACITY_NOTES_MAX) capacity.gloveCommands = CAPACITY_NOTES_MAX;
+    return;
+  }
+  _starts[_count] = atTick;
+  _ends[_count] = atTick + duration;
+  _count++;
+
+  uint16_t sounding = 0;               /* at 'atTick' */
+  uint16_t upcoming = 0;               /* after 't' */
+  uint16_t waitingOff = 0;             /* started before 't', still sounds at 't' */
+  for (i = 0; i < _count; i++) {
+    if (_ends[i] > atTick) sounding++;
+    if ((int32_t)_starts[i] > t) upcoming++;
+    else waitingOff++;
+  }
+  uint16_t gloveCommands = 2 * upcoming + waitingOff;
+  if (sounding > capacity.sounding) capacity.sounding = sounding;
+  if (upcoming > capacity.upcoming) capacity.upcoming = upcoming;
+  if (gloveCommands > capacity.gloveCommands) capacity.gloveCommands = gloveCommands;
+}
@@ -0,0 +1,58 @@
+#ifndef CapacityPlanner_h
+#define CapacityPlanner_h
+
+#include <stdint.h>   /* not Arduino.h: also used by the host tool in 'tools/SongCapacity' */
+
+#define CAPACITY_TEMPO_FACTOR        180   /* worst case: highest tempo factor (most notes within the look-ahead time) */
+#define CAPACITY_LOOK_AHEAD_MILLIS   2100  /* worst case: longest look-ahead (Player3 at slowest animation: 1800 + 300 ms) */
+#define CAPACITY_NOTES_MAX           64    /* notes followed at the same time, must be more than GLOVE_COMMANDS_MAX */
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  SongCapacity
+*
+* Worst case of a song for the fixed-size queues of the players (see CapacityPlanner). After loading the song this is
+* compared with the size of each queue (see getSongCapacityWarning in 3Display.ino).
+*
+*******************************************************************************************************************************/
+class SongCapacity {
+  public:
+    uint16_t sounding;        /* notes that sound at the same time: LED-off schedules, MIDI note-offs */
+    uint16_t upcoming;        /* notes that start within the look-ahead time: upcoming notes (and falling notes, Player3) */
+    uint16_t gloveCommands;   /* glove commands (finger on/off) that wait at the same time */
+};
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  CapacityPlanner
+*
+* One pass over the notes of a song (in order of tick), at the highest tempo of the song and CAPACITY_TEMPO_FACTOR.
+* Each note 'n' is looked at from time 't' = the look-ahead time before 'n' starts: the notes that start after 't' (up to
+* 'n') are upcoming, each with a glove command to turn its finger on and one to turn it off. The notes that started
+* before 't' and still sound, wait for the command to turn their finger off. Only these notes are kept (at most
+* CAPACITY_NOTES_MAX), together they are the glove commands that wait: when more notes must be kept, the glove queue
+* overflows anyway.
+*
+*******************************************************************************************************************************/
+class CapacityPlanner {
+  public:
+    /**
+    * Constructor.
+    */
+    CapacityPlanner(uint32_t resolution, uint16_t tempoQPM);   /* tempoQPM: highest tempo of the song */
+    void addNote(uint32_t atTick, uint32_t duration);         /* call for each note, in order of tick */
+
+    SongCapacity capacity;          /* worst case of the notes added so far */
+    uint32_t lookAheadTicks;        /* look-ahead time in ticks */
+
+  private:
+    uint32_t _starts[CAPACITY_NOTES_MAX];   /* start and end tick of the notes that are kept (not in order) */
+    uint32_t _ends[CAPACITY_NOTES_MAX];
+    int _count;
+};
+
+
+
+#endif // CapacityPlanner_h
@@ -0,0 +1,186 @@
+#ifndef Compositor_h
+#define Compositor_h
+
+#include <Arduino.h>
+#include "LedPanel.h"
+
+#define LAYER_NOTES     0     /* notes to play (bottom layer) */
+#define LAYER_CUES      1     /* cues next to the notes, e.g. left hand cue (grey LED above note, never on a note) */
+#define LAYER_OVERLAY   2     /* overlay text, e.g. measure number */
+#define LAYER_STATUS    3     /* status pixels, e.g. accomplishment per measure (top layer) */
+#define LAYER_COUNT     4     /* all layers (a player only needs the layers up to the highest it uses, see Compositor) */
+#define LAYER_TRANSPARENT  COLOR_IDX_OFF  /* pixel of a layer that shows the layers below */
+
+/******************************************************************************************************************************
+*
+* CLASS  :  Compositor
+*
+* A few fixed layers, each with an indexed color per LED. The LED panel shows the top-most pixel that is not transparent.
+* Each change of a layer pixel extends the dirty rectangle; flatten() only writes the pixels within this rectangle to the
+* LED panel. So a player can change a few pixels (e.g. a key that is pressed) without redrawing the whole panel, and
+* overlays (cues, measure number) do not have to be painted again after each change of the notes below.
+* A layer pixel that does not change does not make the rectangle bigger.
+* LAYERS: layer 0 up to LAYERS-1 are stored (PANEL_LEDS bytes each), e.g. Compositor<LAYER_NOTES + 1> for a player that
+* only shows notes. Players share RAM (PlayerRegion), so each layer less of the largest player is RAM saved.
+*
+*******************************************************************************************************************************/
+template<byte LAYERS> class Compositor {
+  public:
+    /**
+    * Constructor.
+    */
+    Compositor(LedPanel* lp);
+    void clear();                                          /* all layers transparent, whole LED panel dirty */
+    void clearLayer(byte layer);
+    void clearRect(byte layer, int x1, int y1, int x2, int y2);
+    void setPixel(byte layer, int x, int y, byte clr);    /* LAYER_TRANSPARENT: layers below are shown */
+    void scrollDown(byte layer, int y1, int y2);           /* rows y1..y2-1 move 1 row down, row y1 is transparent */
+    void setLayer(byte layer, const byte* pixels);         /* PANEL_LEDS pixels (x*PANEL_ROWS + y), e.g. a prepared frame */
+    byte getPixel(byte layer, int x, int y);
+    bool isColumnEmpty(int x);                             /* true if column is transparent in all layers */
+    int writeText(byte layer, const char* txt, int xStart, byte clr);  /* only the pixels of the characters are set */
+    void setLayerVisible(byte layer, bool visible);
+    bool flatten();                                        /* write dirty pixels to LED panel, false if nothing changed */
+
+    uint16_t pixelsFlattened;                              /* pixels written to LED panel by last flatten() */
+
+  private:
+    LedPanel* _ledPanel;
+    byte _layers[LAYERS][PANEL_LEDS];
+    bool _isVisible[LAYERS];
+    int _dirtyX1, _dirtyY1, _dirtyX2, _dirtyY2;            /* empty if _dirtyX1 > _dirtyX2 */
+
+    void _markDirty(int x1, int y1, int x2, int y2);
+};
+
+
+template<byte LAYERS> Compositor<LAYERS>::Compositor(LedPanel* lp) {
+  _ledPanel = lp;
+  for (int layer = 0; layer < LAYERS; layer++) _isVisible[layer] = true;
+  _dirtyX1 = PANEL_COLS; _dirtyX2 = -1;  /* empty */
+  clear();
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::clear() {
+  for (int layer = 0; layer < LAYERS; layer++) {
+    for (int i = 0; i < PANEL_LEDS; i++) _layers[layer][i] = LAYER_TRANSPARENT;
+  }
+  _markDirty(0, 0, PANEL_COLS - 1, PANEL_ROWS - 1);  /* LED panel may show anything */
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::clearLayer(byte layer) {
+  clearRect(layer, 0, 0, PANEL_COLS - 1, PANEL_ROWS - 1);
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::clearRect(byte layer, int x1, int y1, int x2, int y2) {
+  for (int x = x1; x <= x2; x++) {
+    for (int y = y1; y <= y2; y++) setPixel(layer, x, y, LAYER_TRANSPARENT);
+  }
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::setPixel(byte layer, int x, int y, byte clr) {
+  byte* pixel = &_layers[layer][x*PANEL_ROWS + y];
+  if (*pixel == clr) return;          /* no change: LED panel is not touched */
+  *pixel = clr;
+  if (_isVisible[layer]) _markDirty(x, y, x, y);
+}
+
+
+/* Only the pixels that change are marked dirty (e.g. a column without notes costs no LED panel update). */
+template<byte LAYERS> void Compositor<LAYERS>::scrollDown(byte layer, int y1, int y2) {
+  for (int x = 0; x < PANEL_COLS; x++) {
+    byte* column = &_layers[layer][x*PANEL_ROWS];
+    for (int y = y2; y > y1; y--) setPixel(layer, x, y, column[y - 1]);
+    setPixel(layer, x, y1, LAYER_TRANSPARENT);
+  }
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::setLayer(byte layer, const byte* pixels) {
+  for (int x = 0; x < PANEL_COLS; x++) {
+    for (int y = 0; y < PANEL_ROWS; y++) setPixel(layer, x, y, pixels[x*PANEL_ROWS + y]);
+  }
+}
+
+
+template<byte LAYERS> byte Compositor<LAYERS>::getPixel(byte layer, int x, int y) {
+  return _layers[layer][x*PANEL_ROWS + y];
+}
+
+
+template<byte LAYERS> bool Compositor<LAYERS>::isColumnEmpty(int x) {
+  for (int layer = 0; layer < LAYERS; layer++) {
+    for (int y = 0; y < PANEL_ROWS; y++) {
+      if (_layers[layer][x*PANEL_ROWS + y] != LAYER_TRANSPARENT) return false;
+    }
+  }
+  return true;
+}
+
+
+/* Same layout as LedPanel::writeText() (glyph cache), but background pixels stay transparent. Returns width. */
+template<byte LAYERS> int Compositor<LAYERS>::writeText(byte layer, const char* txt, int xStart, byte clr) {
+  int x = xStart;
+  for (int tIdx = 0; txt[tIdx] != 0; tIdx++) {
+    if (tIdx > 0) x += 2;             /* spacing between characters */
+    const byte* glyph = _ledPanel->getGlyph(txt[tIdx]);
+    int w = _ledPanel->getCharWidth(txt[tIdx]);
+    for (int i = 0; i < w; i++, x++) {
+      if (x < 0 || x >= PANEL_COLS) continue;
+      byte bits = glyph[i];
+      for (int y = 0; y < PANEL_ROWS; y++, bits >>= 1) {
+        if (bits & 1) setPixel(layer, x, y, clr);
+      }
+    }
+  }
+  return x - xStart;
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::setLayerVisible(byte layer, bool visible) {
+  if (_isVisible[layer] == visible) return;
+  _isVisible[layer] = visible;
+  _markDirty(0, 0, PANEL_COLS - 1, PANEL_ROWS - 1);
+}
+
+
+/******************************************************************************************************************************
+* Write the top-most visible pixel that is not transparent to the LED panel, only within the dirty rectangle.
+*******************************************************************************************************************************/
+template<byte LAYERS> bool Compositor<LAYERS>::flatten() {
+  pixelsFlattened = 0;
+  if (_dirtyX1 > _dirtyX2) return false;
+  for (int x = _dirtyX1; x <= _dirtyX2; x++) {
+    for (int y = _dirtyY1; y <= _dirtyY2; y++) {
+      int i = x*PANEL_ROWS + y;
+      byte clr = LAYER_TRANSPARENT;
+      for (int layer = LAYERS - 1; layer >= 0; layer--) {
+        if (_isVisible[layer] && _layers[layer][i] != LAYER_TRANSPARENT) { clr = _layers[layer][i]; break; }
+      }
+      _ledPanel->setPixel(x, y, clr);
+      pixelsFlattened++;
+    }
+  }
+  _dirtyX1 = PANEL_COLS; _dirtyX2 = -1;  /* empty */
+  return true;
+}
+
+
+template<byte LAYERS> void Compositor<LAYERS>::_markDirty(int x1, int y1, int x2, int y2) {
+  if (_dirtyX1 > _dirtyX2) {          /* empty */
+    _dirtyX1 = x1; _dirtyY1 = y1; _dirtyX2 = x2; _dirtyY2 = y2;
+    return;
+  }
+  if (x1 < _dirtyX1) _dirtyX1 = x1;
+  if (y1 < _dirtyY1) _dirtyY1 = y1;
+  if (x2 > _dirtyX2) _dirtyX2 = x2;
+  if (y2 > _dirtyY2) _dirtyY2 = y2;
+}
+
+
+
+#endif // Compositor_h
@@ -189,6 +189,13 @@ void User::setDefaults(int id) {
 int Settings::lastUser = 0;
 char Settings::wifiSSID[MAX_LEN_SSID + 1];
 char Settings::wifiPassword[MAX_LEN_PASSW + 1];
+byte Settings::midiClock = 0;
+bool Settings::record = false;
+int Settings::latencyMidi = DEFAULT_LATENCY_MIDI;
+int Settings::latencyLeds = DEFAULT_LATENCY_LEDS;
+int Settings::latencyMetronome = DEFAULT_LATENCY_METRONOME;
+int Settings::latencyGloves = DEFAULT_LATENCY_GLOVES;
+int Settings::_latencyMidi_cpy = DEFAULT_LATENCY_MIDI;
 int Settings::_lastUser_cpy = 0;
 
 
@@ -212,6 +219,18 @@ void Settings::parseSettings(File* file) {
       row_Value[MAX_LEN_PASSW] = 0;  /* prevent buffer overrun in 'wifiPassword' */
       strcpy(wifiPassword, row_Value);
     }      
+    else if (strcmp(row_Name, "midiclock") == 0)
+      midiClock = atoi(row_Value);
+    else if (strcmp(row_Name, "record") == 0)
+      record = (atoi(row_Value) != 0);
+    else if (strcmp(row_Name, "latencymidi") == 0)
+      latencyMidi = (strcmp(row_Value, "auto") == 0) ? LATENCY_AUTO : atoi(row_Value);
+    else if (strcmp(row_Name, "latencyleds") == 0)
+      latencyLeds = atoi(row_Value);
+    else if (strcmp(row_Name, "latencymetronome") == 0)
+      latencyMetronome = (strcmp(row_Value, "auto") == 0) ? LATENCY_AUTO : atoi(row_Value);
+    else if (strcmp(row_Name, "latencygloves") == 0)
+      latencyGloves = atoi(row_Value);
   }
 }
 
@@ -222,20 +241,39 @@ void Settings::writeSettings(File* file) {
   file->println(wifiSSID);
   file->print("Password:");
   file->println(wifiPassword);
+  file->print("MidiClock:");
+  file->println(midiClock);
+  file->print("Record:");
+  file->println(record ? 1 : 0);
+  file->print("LatencyMidi:");
+  if (latencyMidi == LATENCY_AUTO) file->println("auto"); else file->println(latencyMidi);
+  file->print("LatencyLeds:");
+  file->println(latencyLeds);
+  file->print("LatencyMetronome:");
+  if (latencyMetronome == LATENCY_AUTO) file->println("auto"); else file->println(latencyMetronome);
+  file->print("LatencyGloves:");
+  file->println(latencyGloves);
 }
 
 void Settings::resetDirty() {
   _lastUser_cpy = lastUser;
+  _latencyMidi_cpy = latencyMidi;
 }
   
 bool Settings::isDirty() {
-  return (_lastUser_cpy != lastUser);
+  return (_lastUser_cpy != lastUser || _latencyMidi_cpy != latencyMidi);
 }
 
 void Settings::setDefaultSettings() {
   lastUser = DEFAULT_USER_ID;
   strcpy(wifiSSID, "");
   strcpy(wifiPassword, "");
+  midiClock = 0;
+  record = false;
+  latencyMidi = DEFAULT_LATENCY_MIDI;
+  latencyLeds = DEFAULT_LATENCY_LEDS;
+  latencyMetronome = DEFAULT_LATENCY_METRONOME;
+  latencyGloves = DEFAULT_LATENCY_GLOVES;
 }
 
 
@@ -384,6 +422,8 @@ void Song::parseSong(int id, File* file, byte loadFlags) {
   }
   lastMeasureNr = measureNr; /* keep this number as part of Song object */
   _analyseSong();
+  _buildCheckpoints();
+  _planCapacity();
 }
 
 
@@ -407,21 +447,77 @@ void Song::_analyseSong() {
 }
 
 
+/* One pass over the song. A note that does not sound anymore at the start of a measure, does not sound at the start of
+*  any later measure either: so the first note that may still sound only moves forward. */
+void Song::_buildCheckpoints() {
+  for (int nr = 0; nr <= MAX_MEASURES; nr++) {  /* measure not found: start at first measure (index 0) */
+    checkpoints[nr].noteIdx = 0;
+    checkpoints[nr].sustainIdx = 0;
+  }
+  int sustainIdx = 0;
+  int lastNr = 0;   /* measure-nrs count up (a byte: after 255 measures they start again, keep the first ones) */
+  for (int i = 0; i < noteCount; i++) {
+    SongMeasure* measure = (SongMeasure*)&notes[i];
+    if (measure->type == TYPE_NOTE) continue;   /* only look at measures, not notes */
+    while (sustainIdx < i && (notes[sustainIdx].type != TYPE_NOTE || notes[sustainIdx].atTick + notes[sustainIdx].duration <= measure->atTick)) {
+      sustainIdx++;  /* measure, or note that has ended before this measure */
+    }
+    if (measure->measureNr <= lastNr) continue;
+    lastNr = measure->measureNr;
+    SongCheckpoint* checkpoint = &checkpoints[lastNr];
+    checkpoint->noteIdx = i;
+    checkpoint->sustainIdx = sustainIdx;
+  }
+}
+
+
+/* Worst case for the queues of the players (at the highest tempo of the song), see CapacityPlanner */
+void Song::_planCapacity() {
+  uint16_t tempoQPM = 0;
+  for (int i = 0; i < noteCount; i++) {
+    SongMeasure* measure = (SongMeasure*)&notes[i];
+    if (measure->type != TYPE_NOTE && measure->tempoQPM > tempoQPM) tempoQPM = measure->tempoQPM;
+  }
+  CapacityPlanner planner(resolution, tempoQPM);
+  for (int i = 0; i < noteCount; i++) {
+    if (notes[i].type == TYPE_NOTE) planner.addNote(notes[i].atTick, notes[i].duration);
+  }
+  capacity = planner.capacity;
+}
+
+
 bool* Song::getSongAnalysis() {
   return _songAnalysis;
 }
 
 
 int Song::getMeasureStartIndex(int measureNr) {
-  SongMeasure* measure;
-  for (int i=0; i<noteCount; i++) {
-    measure =(SongMeasure*)&notes[i];
-    if (measure->type == TYPE_NOTE) continue; /* only look at measures, not notes */
-    if (measure->measureNr == measureNr) return i;
+  if (measureNr < 1 || measureNr > MAX_MEASURES) return 0; /* not found, start at first measure */
+  return checkpoints[measureNr].noteIdx;
+}
+
+int Song::getSustainStartIndex(int measureNr) {
+  if (measureNr < 1 || measureNr > MAX_MEASURES) return 0;
+  return checkpoints[measureNr].sustainIdx;
+}
+
+/* The section of measure 'measureNr': from the bookmark at or before it (or the first measure) up to the measure before
+*  the next bookmark (or the last measure). */
+void Song::getBookmarkSection(int measureNr, int* startMeasureNr, int* endMeasureNr) {
+  *startMeasureNr = 1;
+  *endMeasureNr = lastMeasureNr;
+  for (int nr = 2; nr <= lastMeasureNr && nr <= MAX_MEASURES; nr++) {
+    SongMeasure* measure = (SongMeasure*)&notes[checkpoints[nr].noteIdx];
+    if (measure->type != TYPE_MEASURE_BM || measure->measureNr != nr) continue;  /* no bookmark (or measure not found) */
+    if (nr <= measureNr) *startMeasureNr = nr;
+    else {
+      *endMeasureNr = nr - 1;
+      break;
+    }
   }
-  return 0; /* not found, start at first measure */
 }
 
+
 int Song::getNextBookmarkMeasureNr(int curMeasureNr, bool forward) {
   if (!forward && curMeasureNr == 1) curMeasureNr = lastMeasureNr;
   int i = getMeasureStartIndex(curMeasureNr); /* first look-up index of current measure */
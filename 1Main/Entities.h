@@ -4,6 +4,7 @@
 #include <Arduino.h>
 #include <SD.h>
 #include "HardwDefs.h"
+#include "CapacityPlanner.h"
 
 
 /******************************************************************************************************************************
@@ -91,6 +92,14 @@ class User : StorageEntityBase {
 
 #define MAX_LEN_SSID  25
 #define MAX_LEN_PASSW 25
+
+/* Latency (milliseconds) of each output: the output is done this much earlier, so all arrive at the user at the same time */
+#define LATENCY_AUTO               -1                         /* 'auto' in SETTINGS.TXT: MIDI measured at start-up, metronome per player */
+#define DEFAULT_LATENCY_MIDI       0                          /* digital piano: from MIDI note to sound */
+#define DEFAULT_LATENCY_LEDS       MILLIS_TO_WRITE_LED_PANEL  /* LED panel: time to write all LEDs */
+#define DEFAULT_LATENCY_METRONOME  LATENCY_AUTO               /* metronome: sound and LEDs, auto: default of the player */
+#define LATENCY_METRONOME_AUTO     10                         /* metronome: default when auto (Player3: PLAYER3_METRONOME_LEAD) */
+#define DEFAULT_LATENCY_GLOVES     100                        /* gloves: vibrating motor needs time to start-up */
 /******************************************************************************************************************************
 *
 * CLASS  :  Settings
@@ -114,9 +123,16 @@ class Settings : StorageEntityBase {
     static int lastUser;
     static char wifiSSID[MAX_LEN_SSID + 1];       /* only for reading */
     static char wifiPassword[MAX_LEN_PASSW + 1];  /* only for reading */
+    static byte midiClock;                        /* only for reading: 0=off, 1=master, 2=slave (see MidiClock.h) */
+    static bool record;                           /* only for reading: record practice sessions to MIDI files? */
+    static int latencyMidi;                       /* milliseconds, or LATENCY_AUTO (measured at start-up with MIDI echo) */
+    static int latencyLeds;                       /* only for reading, milliseconds */
+    static int latencyMetronome;                  /* only for reading, milliseconds, or LATENCY_AUTO (default of the player) */
+    static int latencyGloves;                     /* only for reading, milliseconds */
     
   private:
     static int _lastUser_cpy;
+    static int _latencyMidi_cpy;
 };
 
 /******************************************************************************************************************************
@@ -172,12 +188,32 @@ class SongMeasure {
 
 
 
-#define MAX_NOTES     1200    /* max amount of song notes  */
+#define MAX_NOTES     1200    /* max amount of song notes (no more than MAX_NOTES_CEILING, see 1Main.ino) */
+#define MAX_MEASURES   255    /* max amount of measures (SongMeasure::measureNr is a byte) */
 #define TYPE_NOTE        0    /* Note             (SongNote object represents a real note like C#, E, F, G#)  */
 #define TYPE_MEASURE     1    /* Measure          (SongNote object represents a measure, therefore SongNote* can be casted to SongMeasure*)  */
 #define TYPE_MEASURE_BM  2    /* Measure/BookMark (same as TYPE_MEASURE, but this measure has an implicit bookmark flag)  */
 
 
+/******************************************************************************************************************************
+*
+* CLASS  :  SongCheckpoint
+* 
+* Where to start playing at a measure, found while loading the song (see Song::getMeasureStartIndex). The tempo in force
+* is that of the measure itself (SongMeasure::tempoQPM). Notes that started before the measure and still sound at its
+* start are all between 'sustainIdx' and 'noteIdx', so a player can start them (with the rest of their duration) too.
+* The sounding notes themselves are not stored: a list per measure would cost up to a few kB of RAM (MAX_MEASURES
+* checkpoints), taken from MAX_NOTES. Instead, the player scans 'sustainIdx'..'noteIdx' once when it starts (see
+* Playback::_startSustainedNotes): only the notes of that span, mostly the measure before, not the whole song.
+*
+*******************************************************************************************************************************/
+class SongCheckpoint {
+  public:
+    uint16_t noteIdx;      /* index of the measure in notes[] */
+    uint16_t sustainIdx;   /* first note that still sounds at the start of the measure (noteIdx if none) */
+};
+
+
 /* flags used while loading a song from SD Card into RAM */
 #define LOAD_FLAG_NONE 0
 #define LOAD_FLAG_LEFT_COLOR 1      /* left hand data with finger colors */
@@ -205,7 +241,9 @@ class Song : StorageEntityBase {
     void parseSong(int songId, File* file, byte loadFlags);
     bool* getSongAnalysis();
     int getNextBookmarkMeasureNr(int curMeasureNr, bool forward);
+    void getBookmarkSection(int measureNr, int* startMeasureNr, int* endMeasureNr);  /* measures between bookmarks */
     int getMeasureStartIndex(int measureNr);
+    int getSustainStartIndex(int measureNr);  /* notes from here up to the measure may still sound at its start */
 
     /* immutable song properties, read from SD Card song-file */
     char songName[100];           /* name of the song */
@@ -217,10 +255,14 @@ class Song : StorageEntityBase {
     SongNote notes[MAX_NOTES];     /* notes within song */
     int noteCount;                 /* how many of MAX_NOTES elements used (this includes measures!)? */
     int lastMeasureNr;             /* Number/Id of the very last measure  */
+    SongCheckpoint checkpoints[MAX_MEASURES + 1];  /* per measure-nr (1 = first measure), see _buildCheckpoints() */
+    SongCapacity capacity;         /* worst case for the queues of the players, see _planCapacity() */
        
   private:
     /* song analysis */
     void _analyseSong();
+    void _buildCheckpoints();
+    void _planCapacity();
     bool _songAnalysis[MAX_UNIQUE_PITCHES]; /* for each piano key: true if pitch is used in song, */
 };
 
@@ -0,0 +1,63 @@
+#include "FrameScheduler.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  FrameScheduler
+*
+*******************************************************************************************************************************/
+
+
+FrameScheduler::FrameScheduler(LedPanel* lp, MidiInterface* mi) {
+  _ledPanel = lp;
+  _midi = mi;
+  isPending = false;
+  _isDeferred = false;
+  _lastWriteMillis = 0;
+  resetStats();
+}
+
+
+void FrameScheduler::requestFrame() {
+  if (isPending) return;            /* coalesce: write all changes at once */
+  isPending = true;
+  _requestMillis = millis();
+}
+
+
+/******************************************************************************************************************************
+* Write the requested frame, if the minimum spacing has passed and the MIDI link has a safe gap (or the frame has waited
+* too long). Returns true if the LEDs were written (so interrupts were disabled, see LEDPANEL_MISSED_MILLIS).
+*******************************************************************************************************************************/
+bool FrameScheduler::handleFrame() {
+  if (!isPending) return false;
+  uint32_t now = millis();
+  if (now - _lastWriteMillis < FRAME_MIN_SPACING_MILLIS) return false;  /* too soon: more changes may follow */
+#ifndef LEDPANEL_DMA
+  if (!_isSafeGap()) {
+    if (!_isDeferred) { framesDeferred++; _isDeferred = true; }
+    if (now - _requestMillis < FRAME_MAX_DEFER_MILLIS) return false;    /* try again next time */
+    framesForced++;
+  }
+#endif
+  isPending = false;
+  _isDeferred = false;
+  _lastWriteMillis = now;
+  return _ledPanel->writeLeds_asm();
+}
+
+
+void FrameScheduler::resetStats() {
+  framesDeferred = 0;
+  framesForced = 0;
+}
+
+
+/* No byte received during FRAME_QUIET_MICROS, no byte waiting in the receive buffer and no message half received. Does not
+   wait: when false, the player reads the bytes first and handleFrame() tries again next time. */
+bool FrameScheduler::_isSafeGap() {
+  if (_midi == NULL) return true;
+  if (_midi->isReceiving()) return false;
+  return _midi->getMicrosSinceLastByte() >= FRAME_QUIET_MICROS;
+}
@@ -0,0 +1,52 @@
+#ifndef FrameScheduler_h
+#define FrameScheduler_h
+
+#include <Arduino.h>
+#include "LedPanel.h"
+#include "Midi.h"
+
+#define FRAME_MIN_SPACING_MILLIS  10    /* at most 100 frames per second: changes in between are written together */
+#define FRAME_QUIET_MICROS        1000  /* no MIDI byte received for this time: the piano is not sending (3 bytes at 31250 baud) */
+#define FRAME_MAX_DEFER_MILLIS    30    /* write the frame anyway, if the MIDI link does not get quiet (e.g. MIDI clock) */
+
+/******************************************************************************************************************************
+*
+* CLASS  :  FrameScheduler
+*
+* Decides when the LED panel is written. writeLeds_asm() disables interrupts for a few milliseconds, so bytes that arrive
+* from the piano in the meantime get lost. So a requested frame is only written in a safe gap of the MIDI link:
+*  - the receive buffer is empty (all received bytes are read by the player), and
+*  - no MIDI message is half received (the rest of it would arrive while interrupts are disabled), and
+*  - no byte was received during the last FRAME_QUIET_MICROS (the piano may be sending a burst, e.g. a chord).
+* Requests are coalesced: the panel is written at most once every FRAME_MIN_SPACING_MILLIS.
+* With LEDPANEL_DMA (interrupts are not disabled) only the minimum spacing is used.
+*
+*******************************************************************************************************************************/
+class FrameScheduler {
+  public:
+    /**
+    * Constructor.
+    */
+    FrameScheduler(LedPanel* lp, MidiInterface* mi);
+    void requestFrame();            /* LED panel has changed: write it as soon as it is safe */
+    bool handleFrame();             /* call often: writes the requested frame when it is time. True if the LEDs were written */
+    void resetStats();
+
+    bool isPending;                 /* frame requested, not yet written */
+    uint32_t framesDeferred;        /* frames that had to wait for a safe gap of the MIDI link */
+    uint32_t framesForced;          /* frames written after FRAME_MAX_DEFER_MILLIS, while the MIDI link was not quiet */
+
+  private:
+    LedPanel* _ledPanel;
+    MidiInterface* _midi;
+    uint32_t _requestMillis;        /* time of first request since last frame written */
+    uint32_t _lastWriteMillis;
+    bool _isDeferred;               /* pending frame was counted in framesDeferred */
+
+    bool _isSafeGap();
+};
+
+
+
+
+#endif // FrameScheduler_h
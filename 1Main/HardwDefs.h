@@ -22,7 +22,7 @@
 *   - V3 (same as V2, but even smaller and also a smaller Arduino form factor: Nano 33 IoT)
 *******************************************************************************************************************************
 * Hardware features:
-* - driving a full color LED panel (61 x 5 LEDs or 73 x 5 LEDs)
+* - driving a full color LED panel (61 x 5 LEDs, 73 x 5 LEDs or 88 x 5 LEDs)
 * - 4 push buttons on the LED panel (select user, select song, reload song, wifi mode)
 * - a foot pedal with 3 pedals (left, middle, right)
 * - a micro-SD card with users, settings and songs.
@@ -42,6 +42,7 @@
 //#define HARDWARE_DEVICE_3    /* compile for: Arduino MKR ZERO (on PCB board V2), 73-key digital piano, no wifi, no vibrating gloves, no metronome  */
 //#define HARDWARE_DEVICE_4    /* compile for: Arduino WIFI 1010 (on PCB board V2), 73-key digital piano, wifi, no vibrating gloves, no metronome  */
 #define HARDWARE_DEVICE_5    /* compile for: Arduino Nano 33 IoT (on PCB board V3), 73-key digital piano, wifi, no vibrating gloves, no metronome  */
+//#define HARDWARE_DEVICE_6    /* compile for: Arduino Nano 33 IoT (on PCB board V3), 88-key digital piano, wifi, no vibrating gloves, no metronome  */
 
 /******************************************************************************************************************************
 * Device characteristics: 
@@ -124,6 +125,24 @@
 #define PANEL_LEFT_MARGIN                6 /* left margin on LED panel (only info/settings screens, to center these) */
 #endif // HARDWARE_DEVICE_5
 
+/******************************************************************************************************************************
+* Device characteristics: 
+* PCB board V3, Arduino Nano 33 IoT (with build-in wifi), used with 88-key piano, no vibrating gloves, no metronome
+* (LED panel of 88 x 5 LEDs: the order of the LEDs is generated from PANEL_COLS, see LedStripOrder in LedPanel.h)
+*******************************************************************************************************************************/
+#ifdef HARDWARE_DEVICE_6
+#define NANO_33_IOT_BOARD                  /* With "Arduino Nano 33 IoT" some PIN numbers are different, see below */
+#define INSTRUMENT_88_KEYS                 /* Digital Piano - 88 keys */
+#define MIDI_PITCH_MIN                  21 /* = MIDI_PITCH_A0 */
+#define MIDI_PITCH_MAX                 108 /* = MIDI_PITCH_C8 */
+#define MIDI_DEFAULT_VELOCITY           80 /* MIDI velocity when the system is playing the song */
+#define MILLIS_TO_WRITE_LED_PANEL        5 /* time in milliseconds to write 88 x 5 LEDs with asm function */
+#define METRONOME_HARDWARE_AVAILABLE  false
+#define GLOVES_HARDWARE_AVAILABLE     false
+#define WIFI_HARDWARE_UBLOX                /* UBLOX chip for Wifi (Arduino MKR WiFi 1010, Nano 33 IoT) */
+#define PANEL_LEFT_MARGIN               13 /* left margin on LED panel (only info/settings screens, to center these) */
+#endif // HARDWARE_DEVICE_6
+
 
 
 #define MAX_UNIQUE_PITCHES        (MIDI_PITCH_MAX - MIDI_PITCH_MIN + 1)    /* max used MIDI-pitches */
@@ -158,6 +177,14 @@
 #define LEDPANEL_BUTTON3_PIN      0  /* all 4 buttons on same PORT!! */
 #define LEDPANEL_BUTTON4_PIN      1  /* all 4 buttons on same PORT!! */
 #endif
+//#define LEDPANEL_DMA               /* write LED strips in the background with DMA (interrupts stay enabled), see LedDma.h */
+//#define LEDPANEL_SIMULATOR         /* no LED strips: frames are rendered to a stream (terminal, images), see LedSim.h */
+
+/******************************************************************************************************************************
+* MIDI (Serial1)
+*******************************************************************************************************************************/
+#define MIDI_SERCOM          SERCOM5  /* Serial1 uses SERCOM5 on all supported boards (MKR and Nano 33 IoT) */
+//#define MIDI_INJECT                 /* tests: bytes can be injected as if received from the piano (see test_KeyToLedLatency) */
 
 /******************************************************************************************************************************
 * Foot Pedal
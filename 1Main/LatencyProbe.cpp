@@ -0,0 +1,110 @@
+#include "LatencyProbe.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  LatencyProbe
+*
+*******************************************************************************************************************************
+* Time is 'micros()' corrected with the time missed while the LED panel was written (interrupts disabled), otherwise the
+* time of writeLeds_asm() itself would be missing from the measured latency.
+*******************************************************************************************************************************/
+
+
+LatencyProbe::LatencyProbe(LedPanel* lp) {
+  _ledPanel = lp;
+  isMeasuring = false;
+  count = 0;
+  overflows = 0;
+  _next = 0;
+  _isPending = false;
+}
+
+
+void LatencyProbe::start() {
+  count = 0;
+  overflows = 0;
+  _next = 0;
+  _isPending = false;
+  _status = 0;
+  _dataCount = 0;
+  isMeasuring = true;
+}
+
+
+void LatencyProbe::stop() {
+  isMeasuring = false;
+  _isPending = false;
+}
+
+
+/******************************************************************************************************************************
+* Parse byte received from piano: a NoteOn with velocity > 0 (any channel, running status supported) is a key press.
+*******************************************************************************************************************************/
+void LatencyProbe::receiveByte(byte b) {
+  if (!isMeasuring) return;
+  if (b >= MidiType::Clock) return;                       /* real-time message (can be in between bytes of other message) */
+  if (b & 0x80) { _status = b & 0xF0; _dataCount = 0; return; }
+  if (_status != MidiType::NoteOn) return;
+  if (++_dataCount < 2) return;                           /* wait for velocity */
+  _dataCount = 0;                                         /* running status: next data byte starts new message */
+  if (b == 0) return;                                     /* velocity 0 means note-off */
+  _rxMicros = _now();                                     /* the last key before the next frame counts */
+  _isPending = true;
+}
+
+
+/* Player without key presses (Player3): timestamp when the note changes the LED panel, the last note before the frame counts */
+void LatencyProbe::noteDue() {
+  if (!isMeasuring) return;
+  _rxMicros = _now();
+  _isPending = true;
+}
+
+
+void LatencyProbe::frameComposed() {
+  if (!_isPending) return;
+  _composeMicros = _since(_rxMicros);
+}
+
+
+void LatencyProbe::frameShown() {
+  if (!_isPending) return;
+  _isPending = false;
+  _samples[_next].compose = _composeMicros;
+  _samples[_next].shown = _since(_rxMicros);
+  if (_samples[_next].shown == 0xFFFF) overflows++;
+  _next = (_next + 1) % PROBE_SAMPLES_MAX;
+  if (count < PROBE_SAMPLES_MAX) count++;
+}
+
+
+/******************************************************************************************************************************
+* p50, p99 and max (microseconds) of all samples in the ring. Sorting is done on a copy (on the stack), samples are kept.
+*******************************************************************************************************************************/
+void LatencyProbe::getPercentiles(bool shown, uint16_t* result) {
+  uint16_t sorted[PROBE_SAMPLES_MAX];
+  for (int i = 0; i < PROBE_PERCENTILES; i++) result[i] = 0;
+  if (count == 0) return;
+  for (int i = 0; i < count; i++) {                       /* insertion sort */
+    uint16_t t = shown ? _samples[i].shown : _samples[i].compose;
+    int j = i;
+    while (j > 0 && sorted[j-1] > t) { sorted[j] = sorted[j-1]; j--; }
+    sorted[j] = t;
+  }
+  result[0] = sorted[(count - 1) * 50 / 100];
+  result[1] = sorted[(count - 1) * 99 / 100];
+  result[2] = sorted[count - 1];
+}
+
+
+uint32_t LatencyProbe::_now() {
+  return micros() + _ledPanel->missedMillis * 1000;
+}
+
+
+uint16_t LatencyProbe::_since(uint32_t micro) {
+  uint32_t d = _now() - micro;
+  return (d <= 0xFFFF) ? d : 0xFFFF;
+}
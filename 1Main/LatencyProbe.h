@@ -0,0 +1,67 @@
+#ifndef LatencyProbe_h
+#define LatencyProbe_h
+
+#include <Arduino.h>
+#include "MidiDefs.h"
+#include "LedPanel.h"
+
+#define PROBE_SAMPLES_MAX   128    /* how many latency samples can be stored in the ring (4 bytes each) */
+#define PROBE_PERCENTILES   3      /* p50, p99 and max */
+
+/******************************************************************************************************************************
+*
+* CLASS  :  LatencyProbe
+*
+* Instrumentation: measures the latency from a key press (NoteOn received from the piano) until the LED panel shows the
+* next frame. 3 moments are timestamped (microseconds):
+*  - RX:      NoteOn message read from Serial1 (MidiInterface passes every byte received, see receiveByte), or a note that is
+*             due changes the LED panel (Player3: row 4, see noteDue)
+*  - compose: frame is complete and writeLeds_asm() starts
+*  - shown:   writeLeds_asm() is done (all LEDs written)
+* Only the time after RX is stored (2 x 16 bits), in a ring of PROBE_SAMPLES_MAX samples.
+* If more keys are pressed before the next frame (chord, or Player1 waiting for all keys of a step), the last key counts.
+*
+*******************************************************************************************************************************/
+class LatencyProbe {
+  public:
+    /**
+    * Constructor.
+    */
+    LatencyProbe(LedPanel* lp);
+    void start();                         /* clear all samples and start measuring */
+    void stop();
+    void receiveByte(byte b);             /* called by MidiInterface for every byte received from piano */
+    void noteDue();                       /* called by a player: a note is due, the LED panel changed (instead of a key) */
+    void frameComposed();                 /* called by LedPanel: writeLeds_asm() starts */
+    void frameShown();                    /* called by LedPanel: writeLeds_asm() is done */
+    void getPercentiles(bool shown, uint16_t* result);  /* result (microseconds): p50, p99, max of compose (false) or shown (true) */
+
+    bool isMeasuring;
+    uint16_t count;                       /* samples in ring (max PROBE_SAMPLES_MAX) */
+    uint16_t overflows;                   /* latencies that did not fit in 16 bits (more than 65 ms), stored as 65535 */
+
+  private:
+    /* 1 sample: time after RX (microseconds) */
+    class LatencySample {
+      public:
+        uint16_t compose;
+        uint16_t shown;
+    };
+    LedPanel* _ledPanel;
+    LatencySample _samples[PROBE_SAMPLES_MAX];
+    uint16_t _next;                       /* index of next sample in _samples */
+    bool _isPending;                      /* key received, waiting for next frame */
+    uint32_t _rxMicros;                   /* time of last key (NoteOn) */
+    uint16_t _composeMicros;              /* time after RX when frame was composed */
+    /* parser of incoming bytes */
+    byte _status;
+    byte _dataCount;
+
+    uint32_t _now();
+    uint16_t _since(uint32_t micro);
+};
+
+
+
+
+#endif // LatencyProbe_h
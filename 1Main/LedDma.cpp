@@ -0,0 +1,182 @@
+#include "LedDma.h"
+#include "LatencyProbe.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  LedDma
+*
+*******************************************************************************************************************************
+* Timing of 1 block (4 LEDs of both strips = 288 bytes): 120 us. The interrupt handler needs about 20 us to encode the
+* next block, so there is plenty of time (also when other interrupts, like the UART, come first).
+* The DMA descriptors of both buffers are linked in a loop: block 0, 2, 4.. use the first descriptor, 1, 3, 5.. the second.
+* The descriptor of the last block ends the loop (DESCADDR = 0), so the DMAC stops by itself.
+*******************************************************************************************************************************/
+
+#ifdef LEDPANEL_DMA
+static DmacDescriptor _dmaDescriptors[LEDDMA_CHANNEL + 1] __attribute__ ((aligned (16)));  /* first descriptor of each channel */
+static DmacDescriptor _dmaWriteBack[LEDDMA_CHANNEL + 1] __attribute__ ((aligned (16)));    /* used by DMAC while busy */
+static DmacDescriptor _dmaDescriptor2 __attribute__ ((aligned (16)));                      /* descriptor of 2nd buffer */
+static DmacDescriptor* _dmaDescriptor1 = &_dmaDescriptors[LEDDMA_CHANNEL];  /* first descriptor of our channel (in BASEADDR) */
+static LedDma* _activeDma = NULL;
+
+extern "C" void DMAC_Handler(void) {
+  if (_activeDma != NULL) _activeDma->handleInterrupt();
+}
+#endif // LEDPANEL_DMA
+
+
+LedDma::LedDma() {
+  latencyProbe = NULL;
+  _isBusy = false;
+  _doneMicros = 0;
+}
+
+
+/******************************************************************************************************************************
+* Set up timer TC4 (2.4 MHz) and the DMAC. Must be called after Arduino's init() (so not in a global constructor).
+*******************************************************************************************************************************/
+bool LedDma::begin(int pin1, int pin2) {
+#ifdef LEDPANEL_DMA
+  byte port = g_APinDescription[pin1].ulPort;
+  uint32_t pinNr1 = g_APinDescription[pin1].ulPin;
+  uint32_t pinNr2 = g_APinDescription[pin2].ulPin;
+  if (g_APinDescription[pin2].ulPort != port || pinNr1 / 8 != pinNr2 / 8) return false;  /* 1 byte must toggle both lines */
+  _mask1 = 1 << (pinNr1 % 8);
+  _mask2 = 1 << (pinNr2 % 8);
+  _outTgl = (volatile uint8_t*)&(PORT->Group[port].OUTTGL.reg) + pinNr1 / 8;
+
+  /* clocks for DMAC and TC4 */
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+  PM->APBCMASK.reg |= PM_APBCMASK_TC4;
+  GCLK->CLKCTRL.reg = GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_TC4_TC5;  /* 48 MHz */
+  while (GCLK->STATUS.bit.SYNCBUSY);
+
+  /* timer TC4: overflow every 20 clocks (417 ns), every overflow triggers 1 DMA beat (1 byte) */
+  TC4->COUNT8.CTRLA.reg = TC_CTRLA_SWRST;
+  while (TC4->COUNT8.CTRLA.bit.SWRST);
+  TC4->COUNT8.CTRLA.reg = TC_CTRLA_MODE_COUNT8 | TC_CTRLA_PRESCALER_DIV1;
+  TC4->COUNT8.PER.reg = 19;
+  while (TC4->COUNT8.STATUS.bit.SYNCBUSY);
+
+  /* DMAC: only set up when nobody did (other channels may be in use), otherwise our channel uses the descriptors in place */
+  if (DMAC->CTRL.bit.DMAENABLE) {
+    _dmaDescriptor1 = (DmacDescriptor*)DMAC->BASEADDR.reg + LEDDMA_CHANNEL;
+  }
+  else {
+    DMAC->BASEADDR.reg = (uint32_t)_dmaDescriptors;
+    DMAC->WRBADDR.reg = (uint32_t)_dmaWriteBack;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+  }
+  /* DMAC channel: 1 byte from RAM (increment) to toggle register (fixed) at each trigger */
+  DMAC->CHID.reg = DMAC_CHID_ID(LEDDMA_CHANNEL);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;       /* reset our own channel only */
+  while (DMAC->CHCTRLA.bit.SWRST);
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(TC4_DMAC_ID_OVF) | DMAC_CHCTRLB_TRIGACT_BEAT;
+  DMAC->CHINTENSET.reg = DMAC_CHINTENSET_TCMPL;
+  NVIC_EnableIRQ(DMAC_IRQn);
+  _activeDma = this;
+  return true;
+#else
+  return false;
+#endif // LEDPANEL_DMA
+}
+
+
+/******************************************************************************************************************************
+* Start sending a frame: 'count' indexed colors for each strip (in order of the LED strip). The arrays must not change
+* until the frame is sent (isBusy). Waits for the previous frame and the WS2812B reset time.
+*******************************************************************************************************************************/
+void LedDma::start(const byte* strip1, const byte* strip2, uint16_t count, const uint32_t* colors) {
+#ifdef LEDPANEL_DMA
+  while (_isBusy) ;                                           /* previous frame not yet sent */
+  while (micros() - _doneMicros < LEDDMA_RESET_MICROS) ;     /* lines LOW long enough: LED strips show last frame */
+  _strip1 = strip1;
+  _strip2 = strip2;
+  _count = count;
+  _colors = colors;
+  _blocks = (count + LEDDMA_LEDS_PER_BLOCK - 1) / LEDDMA_LEDS_PER_BLOCK;
+  _blocksSent = 0;
+  _isBusy = true;
+  _setDescriptor(0, _blocks == 1);
+  if (_blocks > 1) _setDescriptor(1, _blocks == 2);
+  DMAC->CHID.reg = DMAC_CHID_ID(LEDDMA_CHANNEL);
+  DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+  TC4->COUNT8.COUNT.reg = 0;
+  TC4->COUNT8.CTRLA.reg |= TC_CTRLA_ENABLE;                  /* start triggering */
+#endif // LEDPANEL_DMA
+}
+
+
+bool LedDma::isBusy() {
+  return _isBusy;
+}
+
+
+/******************************************************************************************************************************
+* Interrupt: a block is sent, the DMAC continues with the next block (other buffer). Encode the block after that one in
+* the buffer that is free now. After the last block: stop the timer.
+*******************************************************************************************************************************/
+void LedDma::handleInterrupt() {
+#ifdef LEDPANEL_DMA
+  DMAC->CHID.reg = DMAC_CHID_ID(LEDDMA_CHANNEL);
+  DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
+  _blocksSent++;
+  if (_blocksSent >= _blocks) {                              /* frame sent */
+    TC4->COUNT8.CTRLA.reg &= ~TC_CTRLA_ENABLE;
+    _doneMicros = micros();
+    _isBusy = false;
+    if (latencyProbe != NULL) latencyProbe->frameShown();
+    return;
+  }
+  uint16_t block = _blocksSent + 1;                         /* buffer of block just sent is free for this block */
+  if (block < _blocks) _setDescriptor(block, block == _blocks - 1);
+#endif // LEDPANEL_DMA
+}
+
+
+/******************************************************************************************************************************
+* Encode 1 LED of each strip: colors are coded as 0xGGRRBB00, sent most significant bit first. 72 bytes are written to 'out',
+* each is the mask of the lines to toggle in 1 slot (see class description).
+*******************************************************************************************************************************/
+void LedDma::encodeLed(uint32_t color1, uint32_t color2, byte mask1, byte mask2, byte* out) {
+  byte both = mask1 | mask2;
+  for (int i = 0; i < 24; i++) {
+    byte ones = ((color1 & 0x80000000ul) ? mask1 : 0) | ((color2 & 0x80000000ul) ? mask2 : 0);
+    *out++ = both;              /* both lines HIGH */
+    *out++ = both & ~ones;      /* lines that send 0-bit: LOW */
+    *out++ = ones;              /* lines that send 1-bit: LOW */
+    color1 <<= 1;
+    color2 <<= 1;
+  }
+}
+
+
+/* Encode block in its buffer (block 0, 2, 4.. in buffer 0), returns number of bytes */
+uint16_t LedDma::_encodeBlock(uint16_t block) {
+  byte* out = _buffer[block % 2];
+  uint16_t first = block * LEDDMA_LEDS_PER_BLOCK;
+  uint16_t last = min(first + LEDDMA_LEDS_PER_BLOCK, _count);
+  for (uint16_t i = first; i < last; i++) {
+    encodeLed(_colors[_strip1[i]], _colors[_strip2[i]], _mask1, _mask2, out);
+    out += LEDDMA_BYTES_PER_LED;
+  }
+  return (last - first) * LEDDMA_BYTES_PER_LED;
+}
+
+
+void LedDma::_setDescriptor(uint16_t block, bool isLast) {
+#ifdef LEDPANEL_DMA
+  uint16_t bytes = _encodeBlock(block);
+  DmacDescriptor* descriptor = (block % 2 == 0) ? _dmaDescriptor1 : &_dmaDescriptor2;
+  DmacDescriptor* next       = (block % 2 == 0) ? &_dmaDescriptor2 : _dmaDescriptor1;
+  descriptor->BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BLOCKACT_INT | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC;
+  descriptor->BTCNT.reg = bytes;
+  descriptor->SRCADDR.reg = (uint32_t)_buffer[block % 2] + bytes;  /* with SRCINC: address after last byte */
+  descriptor->DSTADDR.reg = (uint32_t)_outTgl;
+  descriptor->DESCADDR.reg = isLast ? 0 : (uint32_t)next;
+#endif // LEDPANEL_DMA
+}
@@ -0,0 +1,66 @@
+#ifndef LedDma_h
+#define LedDma_h
+
+#include <Arduino.h>
+#include "HardwDefs.h"
+
+#define LEDDMA_SLOTS_PER_BIT     3     /* each WS2812B bit is sent as 3 slots: HIGH, data bit, LOW */
+#define LEDDMA_SLOT_NANOS        417   /* 1 slot = 20 clocks of 48 MHz (timer TC4 at 2.4 MHz) */
+#define LEDDMA_BYTES_PER_LED     (24 * LEDDMA_SLOTS_PER_BIT)     /* 1 byte per slot (for both strips at once) */
+#define LEDDMA_LEDS_PER_BLOCK    4     /* LEDs (of each strip) encoded per DMA block: 4 x 30 us */
+#define LEDDMA_BLOCK_SIZE        (LEDDMA_LEDS_PER_BLOCK * LEDDMA_BYTES_PER_LED)
+#define LEDDMA_CHANNEL           0     /* DMAC channel (other channels can be used by others, see init) */
+#define LEDDMA_RESET_MICROS      60    /* WS2812B: LOW for at least 50 us to show the new colors */
+
+class LatencyProbe;
+
+/******************************************************************************************************************************
+*
+* CLASS  :  LedDma
+*
+* Writes 2 WS2812B LED strips in the background with the DMA controller, so interrupts stay enabled (MIDI keeps being
+* received, millis() keeps counting). Both data pins must be in the same byte of the same PORT.
+* Every slot of 417 ns (timer TC4 triggers the DMAC) 1 byte is written to the toggle register (OUTTGL) of that PORT:
+*   slot 1: toggle both lines         -> both HIGH
+*   slot 2: toggle lines with bit 0   -> LOW after 417 ns (WS2812B: 0-bit is 0.4 us HIGH, 0.85 us LOW)
+*   slot 3: toggle lines with bit 1   -> LOW after 833 ns (WS2812B: 1-bit is 0.8 us HIGH, 0.45 us LOW)
+* So each line is toggled exactly twice per bit and always ends LOW, also if a block would be sent too late.
+* The frame is encoded in small blocks: while the DMAC sends one block, the interrupt handler encodes the next block in
+* the other buffer (double-buffered). Encoding (encodeLed) does not use any hardware, so it can be tested on its own.
+*
+*******************************************************************************************************************************/
+class LedDma {
+  public:
+    /**
+    * Constructor.
+    */
+    LedDma();
+    bool begin(int pin1, int pin2);      /* false if pins can not be used (not in the same byte of the same PORT) */
+    void start(const byte* strip1, const byte* strip2, uint16_t count, const uint32_t* colors);  /* indexed colors */
+    bool isBusy();
+    void handleInterrupt();              /* called by DMAC_Handler() when a block is sent */
+    static void encodeLed(uint32_t color1, uint32_t color2, byte mask1, byte mask2, byte* out);
+
+    LatencyProbe* latencyProbe;          /* instrumentation: end of frame is timestamped (see LedPanel::setLatencyProbe) */
+
+  private:
+    byte _buffer[2][LEDDMA_BLOCK_SIZE];  /* double buffer: 1 block is sent while the other is encoded */
+    byte _mask1, _mask2;                 /* bit of each data pin, within the byte of the PORT */
+    volatile uint8_t* _outTgl;           /* byte of the PORT toggle register with both data pins */
+    const byte* _strip1;                 /* indexed colors of frame being sent (in order of LED strip) */
+    const byte* _strip2;
+    const uint32_t* _colors;
+    uint16_t _count;                     /* LEDs per strip */
+    uint16_t _blocks;                    /* blocks in frame */
+    uint16_t _blocksSent;
+    volatile bool _isBusy;
+    uint32_t _doneMicros;                /* end of last frame (for reset time) */
+
+    uint16_t _encodeBlock(uint16_t block);  /* returns bytes */
+    void _setDescriptor(uint16_t block, bool isLast);
+};
+
+
+
+
+#endif // LedDma_h
@@ -1,28 +1,36 @@
 
 #include "LedPanel.h"
+#include "Midi.h"
+#include "LatencyProbe.h"
+#include "Metronome.h"
+#include "LedSim.h"
 
 
 LedPanel::LedPanel() {
 
   // ledstrips:
-  pinMode(LEDPANEL_STRIP1_PIN, OUTPUT);        /* LEDstrip line 1 */
-  digitalWrite(LEDPANEL_STRIP1_PIN, LOW);
-  pinMode(LEDPANEL_STRIP2_PIN, OUTPUT);        /* LEDstrip line 2 */
-  digitalWrite(LEDPANEL_STRIP2_PIN, LOW);
-  
-  _input_for_asm[0] = 0ul;                                                 /* bitmask: none            */
-  _input_for_asm[1] = 1ul << g_APinDescription[LEDPANEL_STRIP1_PIN].ulPin; /* bitmask: only line 1     */
-  _input_for_asm[2] = 1ul << g_APinDescription[LEDPANEL_STRIP2_PIN].ulPin; /* bitmask: only line 2     */
-  _input_for_asm[3] = _input_for_asm[1] | _input_for_asm[2];               /* bitmask: line 1 + line 2 */
-  
-  _input_for_asm[4] =  ((uint32_t)(void*)_colorIdx);    /* ref. to LED-array (61 x 5, or 73 x 5) */
-  setGlobalBrightness(0);   /* this sets _input_for_asm[5]  (pointer to array of colors used)  */
-
-  byte port = g_APinDescription[LEDPANEL_STRIP1_PIN].ulPort;
-  _input_for_asm[6] = (uint32_t)&(PORT->Group[port].OUTCLR.reg); /* store 'Clear' address */
-  _input_for_asm[7] = (uint32_t)&(PORT->Group[port].OUTSET.reg); /* store 'Set' address   */
-
+#ifndef LEDPANEL_SIMULATOR
+  _strips.begin(LEDPANEL_STRIP1_PIN, LEDPANEL_STRIP2_PIN, _colorIdx, LedStripOrder::order);
+#endif
+  setGlobalBrightness(0);   /* this sets the palette (pointer to array of colors used)  */
+  _colorIdx[LED_IDX_PADDING] = COLOR_IDX_OFF;                       /* never changed */
+
+  _cacheGlyphs();
+  missedMillis = 0;
+  framesSent = 0;
+  framesSkipped = 0;
+  _isLastFrameValid = false;  /* first frame is always written */
+  _midi = NULL;
+  _latencyProbe = NULL;
+  _metronome = NULL;
+  _sim = NULL;
+#ifdef LEDPANEL_DMA
+  _isDmaStarted = false;
+  _isDmaAvailable = false;
+  clear();                           /* LEDs are turned OFF with the first write (DMA can not be set up yet) */
+#else
   clear(); writeLeds_asm();          /* turn all LEDs OFF  */
+#endif
 
   // buttons:
   pinMode(LEDPANEL_BUTTON1_PIN, INPUT_PULLUP);   /* push button on LED panel*/
@@ -36,15 +44,19 @@ LedPanel::LedPanel() {
   _button_Mask[3]  = 1ul << g_APinDescription[LEDPANEL_BUTTON4_PIN].ulPin;
   _button_All_Mask = _button_Mask[0] | _button_Mask[1] | _button_Mask[2] | _button_Mask[3];
 
+#ifdef LEDPANEL_SIMULATOR
+  _simButtons = _button_All_Mask;
+  _readBtnRegister = &_simButtons;
+#else
   _readBtnRegister = &PORT->Group[g_APinDescription[LEDPANEL_BUTTON1_PIN].ulPort].IN.reg; /* all buttons on same PORT!! */
+#endif
   _newReading = _formerReading = _button_All_Mask;  /* all buttons OFF (1 = OFF, 0 = ON)  */
 }
 
 void LedPanel::setGlobalBrightness(byte brightnessId)
 {
-  if (brightnessId > 3) brightnessId = 3; /* between 0 and 3 (higher means more brightness) */
-  uint32_t pointerOffset = (brightnessId*256);
-  _input_for_asm[5] =  ((uint32_t)(void*)_colors) + pointerOffset;      /* ref. to colors array       */
+  if (brightnessId >= PANEL_BRIGHTNESS_LEVELS) brightnessId = PANEL_BRIGHTNESS_LEVELS - 1; /* higher means more brightness */
+  _strips.setPalette(LedPalette::colors + brightnessId * PANEL_COLORS);  /* PANEL_COLORS colors (4 bytes each) per level */
 }
 
 /******************************************************************************************************************************
@@ -55,6 +67,7 @@ void LedPanel::setGlobalBrightness(byte brightnessId)
 
 void LedPanel::clear() {
   for (int i=0; i < PANEL_LEDS; i++) { _colorIdx[i] = 0; }
+  for (int row = 0; row < PANEL_ROWS; row++) setRowDimming(row, 0);  /* a new screen is not dimmed by the previous one */
 }
 
 int LedPanel::writeChar(char c, int xStart, byte clr) {
@@ -74,58 +87,67 @@ int LedPanel::writeText(const char* txt, int xStart, byte clr) {
 
 int LedPanel::writeText(const char* txt, int xStart, byte clr, bool keepBG)
 {
-  int tIdx=0;
   int x = xStart;
   xStart = max(0, xStart);
   if (x >= PANEL_COLS) { return 0; }   /* LED panel has 'PANEL_COLS' columns */
-  while (txt[tIdx] != 0)
+  for (int tIdx = 0; txt[tIdx] != 0; tIdx++)
   {
-    int idx = (txt[tIdx]-32);
-    idx = _letter_index[idx] * BYTES_PER_LETTER;  /* each character's pixel-pattern is coded in 8 bytes */
-    
-    while (_letters[idx] != 0) /* 0 means all columns of current char written */
+    if (tIdx > 0) x += 2;              /* spacing between characters */
+    const byte* glyph = getGlyph(txt[tIdx]);
+    int w = getCharWidth(txt[tIdx]);
+    for (int i = 0; i < w; i++, x++)   /* write the columns of the character */
     {
-      byte b = _letters[idx];
-      for (int y=0; y < PANEL_ROWS; y++) /* write a column, 5 pixels (top -> down) */
-      {
-        if (x >=0 ) { 
-          if (b % 2 == 1) {            
-            _colorIdx[x*PANEL_ROWS + y] = clr; 
-          }
-          else if (!keepBG) { /* if keep background, than do not set black (=LED off) pixels */
-            _colorIdx[x*PANEL_ROWS + y] = COLOR_IDX_OFF; 
-          }
-        }
-        b = b >> 1; /* next higher bit in next iteration */
-      }
-      x++;
-      if (x >= PANEL_COLS) { return PANEL_COLS - xStart; }
-      idx++;
-    }
-    tIdx++;
-    if (txt[tIdx] != 0) {
-      x += 2;
       if (x >= PANEL_COLS) { return PANEL_COLS - xStart; }
+      if (x >= 0) writeColumn(x, glyph[i], clr, keepBG);
     }
   }
-  return x - xStart;
+  return min(x, PANEL_COLS) - xStart;
 }
 
 int LedPanel::getTextWidth(const char* txt) {
-  int tIdx = 0;
   int width = 0;
-  while (txt[tIdx] != 0)
+  for (int tIdx = 0; txt[tIdx] != 0; tIdx++)
   {
-    int idx = (txt[tIdx] - ' ');
-    idx = _letter_index[idx] * BYTES_PER_LETTER;  /* each character's pixel-pattern is coded in 8 bytes */    
-    while (_letters[idx++] != 0)  /* 0 means all columns of current char written */
-      width++;
-    tIdx++;
-    if (txt[tIdx] != 0) width += 2;
+    if (tIdx > 0) width += 2;
+    width += getCharWidth(txt[tIdx]);
   }
   return width;  
 }
 
+int LedPanel::getCharWidth(char c) {
+  if (c < GLYPH_FIRST_CHAR || c > GLYPH_LAST_CHAR) c = '?';  /* not in _letter_index */
+  return _glyphWidth[c - GLYPH_FIRST_CHAR];
+}
+
+const byte* LedPanel::getGlyph(char c) {
+  if (c < GLYPH_FIRST_CHAR || c > GLYPH_LAST_CHAR) c = '?';
+  return &_letters[_letter_index[c - GLYPH_FIRST_CHAR] * BYTES_PER_LETTER];  /* each character's pixel-pattern is coded in 8 bytes */
+}
+
+void LedPanel::writeColumn(int x, byte bits, byte clr, bool keepBG) {
+  byte* led = &_colorIdx[x*PANEL_ROWS];
+  for (int y=0; y < PANEL_ROWS; y++) /* write a column, 5 pixels (top -> down) */
+  {
+    if (bits & 1) {
+      led[y] = clr;
+    }
+    else if (!keepBG) { /* if keep background, than do not set black (=LED off) pixels */
+      led[y] = COLOR_IDX_OFF;
+    }
+    bits = bits >> 1; /* next higher bit in next iteration */
+  }
+}
+
+/* Width of each character: 0 means all columns of a character are written (see _letters) */
+void LedPanel::_cacheGlyphs() {
+  for (int i = 0; i < GLYPH_COUNT; i++) {
+    const byte* glyph = &_letters[_letter_index[i] * BYTES_PER_LETTER];
+    byte w = 0;
+    while (glyph[w] != 0) w++;
+    _glyphWidth[i] = w;
+  }
+}
+
 void LedPanel::setPixel(int x, int y, byte clr) {
   _colorIdx[x*PANEL_ROWS + y] = clr;
 }
@@ -146,12 +168,15 @@ void LedPanel::fillRect(int x1, int y1, int x2, int y2, byte clr) {
   }
 }
 
-/* 0 = normal color, 1 = slightly dimmed, ..., 7 = max dimmed */
+/* 0 = normal color, 1 = slightly dimmed, ..., 7 = max dimmed.
+*  The pixels do not change: the dimming is added to the color index of each LED of the row while writing (see Ws2812).
+*  A pixel that is dimmed itself gets no darker than the darkest entry of its color (see dimmedColorIdx). clear() resets it. */
 void LedPanel::setRowDimming(int row, byte dimmingIdx) {
-  for (int x = 0; x < PANEL_COLS; x++) {
-    byte clr = _colorIdx[x*PANEL_ROWS + row];
-    _colorIdx[x*PANEL_ROWS + row] = (clr & 0b11111000) + dimmingIdx;
-  }
+  _strips.setRowOffset(row, min(dimmingIdx, (byte)7));
+}
+
+byte LedPanel::getRowDimming(int row) {
+  return _strips.getRowOffsets()[row];
 }
 
 
@@ -227,7 +252,7 @@ byte LedPanel::getFingerColorIdx(int finger) {
 *       |---<---              |---<---|       |---<---|       |---<---|       |---<---|
 *
 ***************************************************************************************************************************
-* [*] Piano key numbers for 61-key instrument. A 73-key instrument is also supported (12 more piano keys).
+* [*] Piano key numbers for 61-key instrument. Any other size is supported too (e.g. 73 or 88 piano keys): see LedStripOrder.
 ***************************************************************************************************************************
 * Some design decisions explained:
 * Why do LED strips make a zig-zag path? Because it's easier to connect/assemble the physical LED-panel that way.
@@ -237,179 +262,116 @@ byte LedPanel::getFingerColorIdx(int finger) {
 * Why assembly code? Because all above together is impossible to implement in C (speed, timing, data look-ups, etc).
 ***************************************************************************************************************************/
 
-b
-
 
 
 /******************************************************************************************************************************
-* Writes 305 or 365 indexed colors to two LED-strips (WS2812B)              WS2812B:  to send LOW/0  : high 0.4us, low 0.85us
-*                                                                                     to send HIGH/1 : high 0.8us, low 0.45us
-*                                                                                     to send RESET  : low for 50us (minimum)
-* input: _input_for_asm[] array (8 values of type uint32_t):
-*            _input_for_asm[0]: always 0                                              binary: 00000000000000000000000000000000
-*            _input_for_asm[1]: bit-mask of data-pin of LED strip 1         binary (example): 00000000000000000000100000000000
-*            _input_for_asm[2]: bit-mask of data-pin of LED strip 2         binary (example): 00000000000000000000010000000000
-*            _input_for_asm[3]: bit-mask of data-pin of both LED strips     binary (example): 00000000000000000000110000000000
-*            _input_for_asm[4]: pointer to _colorIdx : a byte-array with color-index per LED (305 bytes for 61-key piano)
-*            _input_for_asm[5]: pointer to _colors : an array with all used colors
-*            _input_for_asm[6]: I/O address of port to set the LED strip DATA lines LOW (OUTCLR)
-*            _input_for_asm[7]: I/O address of port to set the LED strip DATA lines HIGH (OUTSET)
-* (to correct timing to compensate for missing interrupts: 4 milliseconds for INSTRUMENT_73_KEYS, 3 ms for INSTRUMENT_61_KEYS )
+* Writes PANEL_LEDS indexed colors to the two LED-strips (WS2812B), see class Ws2812 (the asm routine).
+* The order of the LEDs is generated at compile time (LedStripOrder, from PANEL_COLS and PANEL_ROWS), so any panel size
+* defined in HardwDefs.h is written by the same code.
+* (to correct timing to compensate for missing interrupts, see MILLIS_TO_WRITE_LED_PANEL: 4 milliseconds for 73 keys, etc.)
+* Returns false if the frame is the same as the last frame written: then nothing is written, and interrupts are not disabled
+* (only if the metronome LEDs changed, these are written: 0.12 ms).
+* With LEDPANEL_DMA (see HardwDefs.h) the frame is sent in the background by class LedDma, interrupts are not disabled.
+* With LEDPANEL_SIMULATOR the frame is rendered by class LedSim (see setSimulator), the LED strips are not used.
 *******************************************************************************************************************************/
-void LedPanel::writeLeds_asm()
-{ 
-    __disable_irq();   // Disable interrupts temporarily because we don't want our pulse timing to be messed up.
+static_assert(LEDPANEL_STRIPS == 2, "LedStripOrder is written as pairs: 1 LED of each strip (see Ws2812)");
 
-      asm volatile(
-#ifdef INSTRUMENT_61_KEYS                   // 15 x 4 keys = 60 keys, one key left to do outside the loop
-    "MOV  R0, #15              \n"          // set counter R0 to 15 (each iteration writes 4x5 LEDs), that means 15x20=300 LEDs within iteration.
-#endif
-#ifdef  INSTRUMENT_73_KEYS                  // 18 x 4 keys = 72 keys, one key left to do outside the loop
-    "MOV  R0, #18              \n"          // set counter R0 to 18 (each iteration writes 4x5 LEDs), that means 18x20=360 LEDs within iteration.
-#endif
-    "LSL  R0, R0, #5           \n"
-    "NEG  R0, R0               \n"          // counter R0 is now negative and shifted (R0 = R0 * -32) 
-    
-    "LDR  R5, [%[data], #16]   \n"          // see _input_for_asm[4]. R5 = pointer to array of indexed colors, 1 byte per LED (5 for each piano key)
-    "ADD  R5, R5, #200         \n"
-#ifdef INSTRUMENT_61_KEYS
-    "ADD  R5, R5, #85          \n"          // (R5+19) now points to last LED. Total LEDs = 305 (= 61 piano keys * 5 LEDs)
+bool LedPanel::writeLeds_asm()
+{ 
+    uint32_t hash = _getFrameHash();
+    if (_isLastFrameValid && hash == _lastFrameHash) {  /* identical frame: LEDs already show this */
+      framesSkipped++;
+      if (_metronome != NULL) _metronome->writeLedsNow();
+      return false;
+    }
+    _lastFrameHash = hash;
+    _isLastFrameValid = true;
+    framesSent++;
+    if (_latencyProbe != NULL) _latencyProbe->frameComposed();
+#ifdef LEDPANEL_SIMULATOR
+    if (_sim != NULL) _sim->writeFrame(_colorIdx, _strips.getPalette(), _strips.getRowOffsets());
+    if (_latencyProbe != NULL) _latencyProbe->frameShown();
+    return true;
 #endif
-#ifdef  INSTRUMENT_73_KEYS
-    "ADD  R5, R5, #145         \n"          // (R5+19) now points to last LED. Total LEDs = 365 (= 73 piano keys * 5 LEDs)
+#ifdef LEDPANEL_DMA
+    if (!_isDmaStarted) {
+      _isDmaStarted = true;
+      _isDmaAvailable = _dma.begin(LEDPANEL_STRIP1_PIN, LEDPANEL_STRIP2_PIN);
+    }
+    if (_isDmaAvailable) {
+      while (_dma.isBusy()) ;        /* previous frame is still being sent (from _frame) */
+      _copyFrameInStripOrder();
+      _dma.start(_frame[0], _frame[1], LEDS_PER_STRIP, _strips.getPalette());
+      if (_metronome != NULL) _metronome->writeLedsNow();
+      return true;
+    }
 #endif
-    "LDR  R1, [%[data], #24]   \n"          // see _input_for_asm[6]
-    "MOV  R10, R1              \n"          // R10 = I/O address to drive lines LOW (addrClr)
-
-    "LDR  R1, [%[data], #28]   \n"          // see _input_for_asm[7]
-    "MOV  R6, R1               \n"          // R6 = I/O address to drive lines HIGH (addrSet)
-
-    "LDR  R1, [%[data], #20]   \n"          // see _input_for_asm[5]
-    "MOV  R8, R1               \n"          // R8 = pointer to colors-array (4 bytes for each color)
-    
-"mainLoop%=:\n"
-    "LDRB R1, [R5, #15]        \n"          // write LEDs for 'zig' part of zig-zag path (counted right-to-left) of both LED strips (2 * 5 LEDs)
-    "LDRB R2, [R5, #10]        \n"          // The 'zig' part means: arrow of LED strip is pointing DOWN.
-    "BL   writeLED%=           \n"          // In case of 61-key instrument:
-    "LDRB R1, [R5, #16]        \n"          // - LED strip 1 is doing the LEDS for these 15 piano key numbers: 61, 57, 53, 49, .. ,9, 5 (*)
-    "LDRB R2, [R5, #11]        \n"          // - LED strip 2 is doing the LEDs for these 15 paino key numbers: 60, 56, 52, 48, .. ,8, 4 
-    "BL   writeLED%=           \n"          //                                       (*) the last piano key 1 is done outside this mainLoop
-    "LDRB R1, [R5, #17]        \n"
-    "LDRB R2, [R5, #12]        \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #18]        \n"
-    "LDRB R2, [R5, #13]        \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #19]        \n"
-    "LDRB R2, [R5, #14]        \n"
-    "BL    writeLED%=          \n"   
-    
-    "LDRB R1, [R5, #9]         \n"          // write LEDs for 'zag' part of zig-zag path (counted right-to-left) of both LED strips (2 * 5 LEDs)
-    "LDRB R2, [R5, #4]         \n"          // The 'zag' part means: arrow of LED strip is pointing UP.
-    "BL   writeLED%=           \n"          // In case of 61-key instrument:
-    "LDRB R1, [R5, #8]         \n"          // - LED strip 1 is doing the LEDS for these 15 piano key numbers: 59, 55, 51, 47, .. ,7, 3
-    "LDRB R2, [R5, #3]         \n"          // - LED strip 2 is doing the LEDs for these 15 paino key numbers: 58, 54, 50, 46, .. ,6, 2 
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #7]         \n"
-    "LDRB R2, [R5, #2]         \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #6]         \n"
-    "LDRB R2, [R5, #1]         \n"
-    "BL   writeLED%=           \n"   
-    "SUB  R5, R5, #20          \n"          // step 20 bytes backwards in indexed colors table (to prepare for next iteration)
-    "LDRB R1, [R5, #25]        \n"
-    "LDRB R2, [R5, #20]        \n"
-    "BL   writeLED%=           \n"   
-
-    ".syntax unified           \n"
-    "ADDS R0, R0, #32          \n"          // increase counter (low 5 bits have other counting function). Total 15 iterations for 300 LEDs
-    ".syntax divided           \n"
-
-    "BNE   mainLoop%=          \n"          // if counter <> 0, write another series of 20 LEDs
-
-    "LDRB R1, [R5, #15]        \n"          // write the last 5 LEDs (one piano key left to handle outside mainLoop)
-    "MOV  R2, #0               \n"          // all piano keys of line 2 (R2) already written: write color index '0': will do nothing, because there are no more LEDs
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #16]        \n"
-    "MOV  R2, #0               \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #17]        \n"
-    "MOV  R2, #0               \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #18]        \n"
-    "MOV  R2, #0               \n"
-    "BL   writeLED%=           \n"   
-    "LDRB R1, [R5, #19]        \n"
-    "MOV  R2, #0               \n"
-    "BL   writeLED%=           \n"   
-    
-    "B   finished%=            \n"     // Finished: all LEDs written! (305 for 61-key instrument, or 365 for 73-key instrument).
-    
-"writeLED%=:\n"                        // looks up two RGB values and writes each of the 24 bits of both to two separate WS2812B-lines
-    "LSL  R1, R1, #2    \n"            // (line 1) R1 = offset in color table (0, 4, 8, etc)
-    "ADD  R1, R1, R8    \n"            // (line 1) R1 = pointer to the right color (4-byte value)
-    "LDR  R1, [R1]      \n"            // (line 1) R1 is now 24-bit color (coded as 0xGGRRBB00)
-    "LSL  R2, R2, #2    \n"            // (line 2) R2 = offset in color table (0, 4, 8, etc)
-    "ADD  R2, R2, R8    \n"            // (line 2) R2 = pointer to the right color (4-byte value)
-    "LDR  R2, [R2]      \n"            // (line 2) R2 is now 24-bit color (coded as 0xGGRRBB00)
-    
-    "ADD R0, R0, #24    \n"            // set counter to 24 (for each bit of RGB-color)
-"writeBit%=:\n"  
-    "LDR  R3, [%[data], #12]   \n"     // see _input_for_asm[3]. R3 is pinMask for both lines
-    "STR  R3, [R6]             \n"     // drive both lines HIGH
-
-//    "nop\n"                            /* almost no NOPs needed, because of code below */ 
-   
-    ".syntax unified         \n"
-    "LSLS R1, R1, #1         \n"       // shift bit out of R1 (line 1) into carry flag
-    ".syntax divided         \n"
-    "SBC  R4, R4,R4          \n"       // R4=0xFFFFFFFF (if carry=0) or R4=0 (if carry=1)
-    "MOV  R3, #4             \n"
-    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 4 (shifted bit was 0)
-    "MOV  R9, R3             \n"
-    
-    ".syntax unified         \n"
-    "LSLS R2, R2, #1         \n"       // shift bit out of R2 (line 2) into carry flag
-    ".syntax divided         \n"
-    "SBC  R4, R4, R4         \n"       // R4=0xFFFFFFFF (if carry=0) or R4=0 (if carry=1)
-    "MOV  R3, #8             \n"
-    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 8 (shifted bit was 0)
-    "ADD  R3, R3, R9         \n"       // R3 is offset 0, 4, 8 or 12 (to get the right pinMask)
-
-    "LDR  R3, [%[data], R3]  \n"       // R3 = pinMask, for the lines that send 0-bit (must be driven LOW after 0.4us)
-	                                   // see _input_for_asm[x] where x = 0/1/2/3
-
-    "MOV  R4, R10            \n"       // R4 = addrClr (I/O address to drive lines low)
-    "STR  R3, [R4]           \n"       // drive lines (only lines that send 0-bit) LOW
-    
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up approx. 0.8us */ 
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
- //   "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
- //   "nop\n" "nop\n"
-   
-    "LDR  R3, [%[data], #12] \n"       // R3 is pinMask for both lines
-    "STR  R3, [R4]           \n"       // drive all lines low (also lines that send 1-bit, this is after approx. 0.8us)
-
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up some time */ 
- //   "nop\n" "nop\n"
-     
-    "MOV  R3, #31                   \n"     // mask for counter, because R3 has double counting function
-    "SUB R0, R0, #1                 \n"     // decrease bit-counter by 1
-    ".syntax unified                \n"
-    "ANDS R3, R0, R3                \n"     // are lower 5-bits of counter all zero?
-    ".syntax divided\n"
-
-    "BNE   writeBit%=               \n"     // write another bit while bit-counter >= 1
-    "MOV   PC, LR                   \n"     // return to caller
-
-"finished%=:\n"    
-    :
-    : [data] "r" (_input_for_asm)
-    : "r0", "r1", "r2", "r3", "r4", "r5","r6", "r8", "r9", "r10", "cc"  /* clobbers */
-    );
+    __disable_irq();   // Disable interrupts temporarily because we don't want our pulse timing to be messed up.
+
+      _strips.write();
+    if (_metronome != NULL) _metronome->writeLeds();  /* metronome LEDs (if changed): in the same 'blackout' */
 
     delayMicroseconds(100);  // Hold the line low for 50 microseconds to send the reset signal. 
+    if (_midi != NULL) _midi->checkLinkStatus();  /* before the UART interrupt handler clears the error flags */
     __enable_irq();         // Re-enable interrupts now that we are done.
+    missedMillis += MILLIS_TO_WRITE_LED_PANEL;
+    if (_latencyProbe != NULL) _latencyProbe->frameShown();
+    return true;
+}
+
+
+#ifdef LEDPANEL_DMA
+/* Same order as writeLeds_asm() (see LedStripOrder), row dimming added. Strip 2 may end with an extra LED 'off' (LED_IDX_PADDING). */
+void LedPanel::_copyFrameInStripOrder() {
+  for (int i = 0; i < LEDPANEL_STRIPS * LEDS_PER_STRIP; i++) {
+    uint16_t entry = LedStripOrder::order[i];
+    _frame[i % LEDPANEL_STRIPS][i / LEDPANEL_STRIPS] = dimmedColorIdx(_colorIdx[entry & WS2812_INDEX_MASK], getRowDimming(entry >> WS2812_ROW_SHIFT));
+  }
+}
+#endif
+
+
+/* FNV-1a hash of all LEDs and the colors used (global brightness, row dimming): much faster than writing the LEDs (about 30 us) */
+uint32_t LedPanel::_getFrameHash() {
+  uint32_t hash = 2166136261ul ^ (uint32_t)(uintptr_t)_strips.getPalette();
+  for (int row = 0; row < PANEL_ROWS; row++) {
+    hash ^= getRowDimming(row);
+    hash *= 16777619ul;
+  }
+  for (int i = 0; i < PANEL_LEDS; i++) {
+    hash ^= _colorIdx[i];
+    hash *= 16777619ul;
+  }
+  return hash;
+}
+
+
+void LedPanel::resetFrameStats() {
+  framesSent = 0;
+  framesSkipped = 0;
+}
+
+
+void LedPanel::setMidi(MidiInterface* mi) {
+  _midi = mi;
+}
+
+void LedPanel::setMetronome(Metronome* m) {
+  _metronome = m;
+  if (_metronome != NULL) _metronome->setSharedWrite(true);
+}
+
+
+void LedPanel::setSimulator(LedSim* sim) {
+  _sim = sim;
+}
+
+
+void LedPanel::setLatencyProbe(LatencyProbe* p) {
+  _latencyProbe = p;
+#ifdef LEDPANEL_DMA
+  _dma.latencyProbe = p;
+#endif
 }
 
 
@@ -3,11 +3,27 @@
 
 #include <Arduino.h>
 #include "HardwDefs.h"
+#include "Ws2812.h"
+#ifdef LEDPANEL_DMA
+#include "LedDma.h"
+#endif
 
 #define PANEL_COLS (MAX_UNIQUE_PITCHES)       /* LED-panel columns (=number of piano keys) */
 #define PANEL_ROWS 5                          /* LED-panel rows (=number of LEDs per piano key) */
 #define PANEL_LEDS (PANEL_COLS * PANEL_ROWS)  /* total number of LEDs */
 #define BYTES_PER_LETTER 8                    /* bytes used to code LED-pixels of 1 character */
+#define GLYPH_FIRST_CHAR ' '                   /* first character in _letter_index (ASCII 32) */
+#define GLYPH_LAST_CHAR  ']'                   /* last character in _letter_index (ASCII 93) */
+#define GLYPH_COUNT (GLYPH_LAST_CHAR - GLYPH_FIRST_CHAR + 1)
+#define LEDPANEL_STRIPS 2                     /* LED strips, interleaved: strip 1 has the last piano key, strip 2 the one before, etc */
+#define LEDS_PER_STRIP (((PANEL_COLS + LEDPANEL_STRIPS - 1) / LEDPANEL_STRIPS) * PANEL_ROWS)  /* strip 1 may have 1 piano key more */
+#define LED_IDX_PADDING PANEL_LEDS            /* extra LED 'off' (at the end of a strip that has 1 piano key less) */
+
+#if defined(LEDPANEL_DMA) || defined(LEDPANEL_SIMULATOR)
+#define LEDPANEL_MISSED_MILLIS  0     /* LEDs are written in the background (or simulated): interrupts are not disabled */
+#else
+#define LEDPANEL_MISSED_MILLIS  MILLIS_TO_WRITE_LED_PANEL  /* time millis() misses each time the LEDs are written */
+#endif
 
 #define BUTTON_USER   0         /* 1st button on the LED panel: select user */
 #define BUTTON_SONG   1         /* 2nd button on the LED panel: select song */
@@ -22,8 +38,20 @@
 #define COLOR_IDX_PURPLE   40
 #define COLOR_IDX_YELLOW   48
 #define COLOR_IDX_RED      56
+#define PANEL_COLORS       64   /* colors per brightness level: 8 colors (above), each with 8 dimming steps (+ 0..7) */
+
+#ifndef PANEL_BRIGHTNESS_LEVELS
+#define PANEL_BRIGHTNESS_LEVELS 4   /* levels of setGlobalBrightness(): a device profile may use less (less flash) */
+#endif
+#ifndef PANEL_GAMMA
+#define PANEL_GAMMA           1.0   /* dimming steps: 1.0 = linear (8/8, 7/8, .., 1/8), > 1.0 = more steps at the dark end (a device profile may tune it) */
+#endif
+
+class MidiInterface;
+class LatencyProbe;
+class Metronome;
+class LedSim;
 
-extern const uint32_t _colors[] PROGMEM;
 extern const byte _letters[] PROGMEM;
 extern const byte _letter_index[] PROGMEM;
 extern const byte _colorIdx_users[] PROGMEM;
@@ -31,6 +59,133 @@ extern const byte _colorIdx_fingers[] PROGMEM;
 
 
 
+/******************************************************************************************************************************
+* Order in which the LED strips are wired (see LedPanel.cpp), computed at compile time from PANEL_COLS and PANEL_ROWS.
+* Strip s starts at the piano key most to the right (column PANEL_COLS-1-s) and then does every LEDPANEL_STRIPS-th key to
+* the left, in a zig-zag manner: the 1st, 3rd, 5th.. key of a strip from row 0 to row 4, the others from row 4 to row 0.
+* ledOrderIndex(s, i) is the LED index (x * PANEL_ROWS + y) of the i-th LED of strip s, or LED_IDX_PADDING if there is none.
+* ledOrderEntry(s, i) is the same, with the row added (for Ws2812: row dimming), see WS2812_ROW_SHIFT.
+*******************************************************************************************************************************/
+constexpr int ledOrderColumn(int strip, int i) {
+  return PANEL_COLS - 1 - strip - LEDPANEL_STRIPS * (i / PANEL_ROWS);
+}
+
+constexpr int ledOrderRow(int i) {
+  return ((i / PANEL_ROWS) % 2 == 0) ? (i % PANEL_ROWS) : (PANEL_ROWS - 1 - i % PANEL_ROWS);
+}
+
+constexpr uint16_t ledOrderIndex(int strip, int i) {
+  return (ledOrderColumn(strip, i) >= 0) ? ledOrderColumn(strip, i) * PANEL_ROWS + ledOrderRow(i) : LED_IDX_PADDING;
+}
+
+constexpr uint16_t ledOrderEntry(int strip, int i) {
+  return ledOrderIndex(strip, i) | (ledOrderRow(i) << WS2812_ROW_SHIFT);
+}
+
+static_assert(PANEL_LEDS < WS2812_INDEX_MASK && PANEL_ROWS <= WS2812_MAX_ROWS, "LED panel too big for the order table");
+
+/* Table with the entries for all strips interleaved: {strip 1 LED 0, strip 2 LED 0, strip 1 LED 1, ..}, stored in flash.
+*  Use: LedStripOrder::order[] (template magic below only generates the list 0, 1, 2, .. , LEDPANEL_STRIPS * LEDS_PER_STRIP - 1) */
+template<int... I> struct LedOrderTable {
+  static const uint16_t order[sizeof...(I)];
+};
+template<int... I> const uint16_t LedOrderTable<I...>::order[sizeof...(I)] = {
+  ledOrderEntry(I % LEDPANEL_STRIPS, I / LEDPANEL_STRIPS)...
+};
+template<template<int...> class TABLE, int N, int... I> struct LedTableMaker : LedTableMaker<TABLE, N - 1, N - 1, I...> {};
+template<template<int...> class TABLE, int... I> struct LedTableMaker<TABLE, 0, I...> { typedef TABLE<I...> table; };
+typedef LedTableMaker<LedOrderTable, LEDPANEL_STRIPS * LEDS_PER_STRIP>::table LedStripOrder;
+
+/* Compile-time check of the entries of LedStripOrder (same as test_LedStripOrder): the row bits are the row of the LED
+*  index, a strip starts at its right-most piano key on row 0, goes up/down 1 row per LED and turns on the same row at the
+*  next piano key (LEDPANEL_STRIPS keys to the left), padding only at the end of a strip, and all LEDs are in the table. */
+constexpr bool ledOrderIsNext(uint16_t idx, uint16_t row, uint16_t prevIdx, uint16_t prevRow, int i) {
+  return (i % PANEL_ROWS == 0) ? (idx / PANEL_ROWS + LEDPANEL_STRIPS == prevIdx / PANEL_ROWS && row == prevRow)
+                               : (idx / PANEL_ROWS == prevIdx / PANEL_ROWS && (row == prevRow + 1 || row + 1 == prevRow));
+}
+
+constexpr bool ledOrderIsValid(int strip, int i, uint16_t entry, uint16_t prevEntry) {
+  return ((entry & WS2812_INDEX_MASK) == LED_IDX_PADDING)
+           ? (i > 0)
+           : ((entry & WS2812_INDEX_MASK) < PANEL_LEDS
+              && (entry & WS2812_INDEX_MASK) % PANEL_ROWS == (entry >> WS2812_ROW_SHIFT)
+              && (i == 0 ? (entry == (PANEL_COLS - 1 - strip) * PANEL_ROWS)
+                         : ((prevEntry & WS2812_INDEX_MASK) != LED_IDX_PADDING
+                            && ledOrderIsNext(entry & WS2812_INDEX_MASK, entry >> WS2812_ROW_SHIFT,
+                                              prevEntry & WS2812_INDEX_MASK, prevEntry >> WS2812_ROW_SHIFT, i))));
+}
+
+constexpr bool ledOrderIsValid(int strip, int i = 0) {
+  return i >= LEDS_PER_STRIP
+         || (ledOrderIsValid(strip, i, ledOrderEntry(strip, i), (i > 0) ? ledOrderEntry(strip, i - 1) : 0)
+             && ledOrderIsValid(strip, i + 1));
+}
+
+constexpr int ledOrderCount(int strip, int i = 0) {
+  return (i >= LEDS_PER_STRIP) ? 0 : ((ledOrderIndex(strip, i) != LED_IDX_PADDING) ? 1 : 0) + ledOrderCount(strip, i + 1);
+}
+
+static_assert(LEDPANEL_STRIPS == 2 && ledOrderIsValid(0) && ledOrderIsValid(1), "LedStripOrder: wrong order of the LEDs");
+static_assert(ledOrderCount(0) + ledOrderCount(1) == PANEL_LEDS, "LedStripOrder: not all LEDs are in the table");
+
+
+
+/******************************************************************************************************************************
+* Palette of the LED panel (see Ws2812::setPalette), computed at compile time: PANEL_COLORS colors for each brightness level.
+* A color is its hue (weight of red, green and blue, 1.0 = max. brightness of the level) times the brightness curve, then
+* dimmed in 8 steps with gamma PANEL_GAMMA. Blue and red are weighted more than 1.0: these look darker on the LED strips.
+* To add a color: add a hue (and COLOR_IDX_xxx, PANEL_COLORS); to add a brightness level: add a value to the curve.
+*******************************************************************************************************************************/
+constexpr byte ledBrightnessCurve[] = { 32, 64, 128, 192 };  /* max. brightness (of 255) of each level (at weight 1.0) */
+
+constexpr double ledHues[][3] = {    /* R, G, B */
+  { 0.0, 0.0, 0.0 },                 /* COLOR_IDX_OFF */
+  { 1.0, 1.0, 1.0 },                 /* COLOR_IDX_WHITE */
+  { 0.5, 0.5, 0.5 },                 /* COLOR_IDX_GREY */
+  { 0.0, 0.0, 4.0 / 3 },             /* COLOR_IDX_BLUE */
+  { 0.0, 1.0, 0.0 },                 /* COLOR_IDX_GREEN */
+  { 1.0, 0.0, 1.0 },                 /* COLOR_IDX_PURPLE */
+  { 1.0, 1.0, 0.0 },                 /* COLOR_IDX_YELLOW */
+  { 1.2, 0.0, 0.0 },                 /* COLOR_IDX_RED */
+};
+
+static_assert(sizeof(ledHues) / sizeof(ledHues[0]) * 8 == PANEL_COLORS, "each hue has 8 dimming steps");
+static_assert(PANEL_BRIGHTNESS_LEVELS >= 1 && PANEL_BRIGHTNESS_LEVELS <= sizeof(ledBrightnessCurve), "brightness curve too short");
+static_assert(PANEL_BRIGHTNESS_LEVELS <= PANEL_ROWS, "settings screen shows the brightness level as a column of LEDs");
+
+/* x ^ p for 0 < x <= 1 (ln and exp as series: no <math.h> at compile time) */
+constexpr double ledLnSeries(double y2, double term, int k) {
+  return (k > 99) ? 0.0 : term / k + ledLnSeries(y2, term * y2, k + 2);
+}
+constexpr double ledLn(double x) {
+  return 2 * ledLnSeries(((x - 1) / (x + 1)) * ((x - 1) / (x + 1)), (x - 1) / (x + 1), 1);
+}
+constexpr double ledExpSeries(double x, double term, int n) {
+  return (n > 40) ? term : term + ledExpSeries(x, term * x / n, n + 1);
+}
+constexpr double ledPow(double x, double p) {
+  return (p == 1.0) ? x : ledExpSeries(p * ledLn(x), 1.0, 1);
+}
+
+constexpr byte ledChannel(double peak, int dim) {  /* peak: 0..255 (clipped), dim: 0..7 */
+  return (byte)((peak > 255 ? 255 : peak) * ledPow((8.0 - dim) / 8, PANEL_GAMMA));
+}
+
+constexpr uint32_t ledPaletteColor(int i) {  /* i: level * PANEL_COLORS + color index */
+  return ledColor(ledChannel(ledBrightnessCurve[i / PANEL_COLORS] * ledHues[(i % PANEL_COLORS) / 8][0], i % 8),
+                  ledChannel(ledBrightnessCurve[i / PANEL_COLORS] * ledHues[(i % PANEL_COLORS) / 8][1], i % 8),
+                  ledChannel(ledBrightnessCurve[i / PANEL_COLORS] * ledHues[(i % PANEL_COLORS) / 8][2], i % 8));
+}
+
+/* Use: LedPalette::colors[] (flash: only the PANEL_BRIGHTNESS_LEVELS levels used) */
+template<int... I> struct LedPaletteTable {
+  static constexpr uint32_t colors[sizeof...(I)] = { ledPaletteColor(I)... };  /* constexpr: never computed at run time */
+};
+template<int... I> constexpr uint32_t LedPaletteTable<I...>::colors[sizeof...(I)];
+typedef LedTableMaker<LedPaletteTable, PANEL_BRIGHTNESS_LEVELS * PANEL_COLORS>::table LedPalette;
+
+
+
 /*
 *
 *
@@ -48,17 +203,29 @@ class LedPanel {
     int writeChar(char c, int columnStart, byte clr);
     int writeChar(char c, int columnStart, byte clr, bool keepBG);
     int getTextWidth(const char* txt);
+    int getCharWidth(char c);                 /* from glyph cache: columns of character (without spacing) */
+    const byte* getGlyph(char c);             /* columns of character: 5 bits each (bit 0 = row 0) */
+    void writeColumn(int x, byte bits, byte clr, bool keepBG);  /* 5 bits: bit 0 = row 0 */
     void setPixel(int x, int y, byte clr);
     byte getPixel(int x, int y);
     void fillRect(int x1, int y1, int x2, int y2, byte clr);
     byte getUserColorIdx(int idUser); 
     byte getFingerColorIdx(int finger);
-    void setGlobalBrightness(byte brightnessId);  /*brightnessId: 0 for lowest, 3 for highest */
+    void setGlobalBrightness(byte brightnessId);  /*brightnessId: 0 for lowest, PANEL_BRIGHTNESS_LEVELS-1 for highest */
     void setRowDimming(int row, byte dimmingIdx);  /* 0 = normal color, 1 = slightly dimmed, ..., 7 = max dimmed */
+    byte getRowDimming(int row);
     void SetColorInArea(int x1, int y1, int x2, int y2, byte clr);
     bool IsColumnEmpty(int x);
     
-    void writeLeds_asm();
+    bool writeLeds_asm();     /* false if frame did not change (not written, interrupts not disabled) */
+    uint32_t missedMillis;    /* total time that millis() missed, because interrupts were disabled by writeLeds_asm() */
+    uint32_t framesSent;      /* frames written by writeLeds_asm() */
+    uint32_t framesSkipped;   /* frames not written, because identical to the last frame written */
+    void resetFrameStats();
+    void setMidi(MidiInterface* mi);  /* MIDI link status is checked each time interrupts were disabled */
+    void setMetronome(Metronome* m);  /* metronome LEDs are written together with the LED panel (1 time interrupts disabled) */
+    void setLatencyProbe(LatencyProbe* p);  /* instrumentation: start and end of each writeLeds_asm() are timestamped */
+    void setSimulator(LedSim* sim);   /* LEDPANEL_SIMULATOR: each frame is rendered by 'sim' (instead of the LED strips) */
     /*  buttons: */
     uint32_t readButtons();
     inline bool isButtonDown(int btn) { return _isButton(false, btn); }
@@ -67,13 +234,32 @@ class LedPanel {
   protected:
 
   private:
+    MidiInterface* _midi;
+    LatencyProbe* _latencyProbe;
+    Metronome* _metronome;
+    LedSim* _sim;
     /* ledstrips: */
-    unsigned char _colorIdx[PANEL_LEDS];  /* every led can have own indexed color */
-    uint32_t _input_for_asm[8];           /* used to pass data to assembler routine */
+    unsigned char _colorIdx[PANEL_LEDS + 1];  /* every led can have own indexed color (+ LED_IDX_PADDING: always 'off') */
+    Ws2812Strips<LEDPANEL_STRIPS, LEDS_PER_STRIP> _strips;  /* writes both LED strips (asm routine) */
+    byte _glyphWidth[GLYPH_COUNT];        /* width of each character, so text is not measured column by column */
+    void _cacheGlyphs();
+    uint32_t _lastFrameHash;              /* hash of last frame written */
+    bool _isLastFrameValid;
+    uint32_t _getFrameHash();
+#ifdef LEDPANEL_DMA
+    LedDma _dma;
+    bool _isDmaStarted;                   /* DMA is set up at first write (after Arduino's init()) */
+    bool _isDmaAvailable;
+    byte _frame[LEDPANEL_STRIPS][LEDS_PER_STRIP];       /* copy of _colorIdx in order of both LED strips (sent in background) */
+    void _copyFrameInStripOrder();
+#endif
     /* buttons: */
     uint32_t _button_Mask[4];
     uint32_t _button_All_Mask;
     volatile uint32_t *_readBtnRegister; /* all buttons on the same Arduino PORT! */
+#ifdef LEDPANEL_SIMULATOR
+    volatile uint32_t _simButtons;       /* LEDPANEL_SIMULATOR: instead of the PORT, all buttons OFF */
+#endif
     uint32_t _newReading, _formerReading;
     bool _isButton(bool onlyNewPress, int button);
 };
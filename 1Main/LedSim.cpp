@@ -0,0 +1,88 @@
+#include "LedSim.h"
+
+
+LedSim::LedSim() {
+  _out = NULL;
+  _log = NULL;
+  _format = LEDSIM_ANSI;
+  _gain = 1;
+  frames = 0;
+  _lastMicros = 0;
+}
+
+
+void LedSim::begin(Print* out, byte format, byte gain, Print* log) {
+  _out = out;
+  _format = format;
+  _gain = max(gain, (byte)1);
+  _log = log;
+  frames = 0;
+  _lastMicros = micros();
+  if (_log != NULL) _log->println("frame,millis,micros,dtMicros,renderMicros,ledsOn");
+}
+
+
+void LedSim::writeFrame(const byte* colorIdx, const uint32_t* palette, const byte* rowDimming) {
+  if (_out == NULL) return;
+  uint32_t start = micros();
+  _colorIdx = colorIdx;
+  _palette = palette;
+  _rowDimming = rowDimming;
+  if (_format == LEDSIM_PPM) _writePpm();
+  else _writeAnsi();
+  frames++;
+  if (_log != NULL) {
+    int ledsOn = 0;
+    for (int i = 0; i < PANEL_LEDS; i++) if (palette[dimmedColorIdx(colorIdx[i], rowDimming[i % PANEL_ROWS])] != 0) ledsOn++;
+    char buf[80];
+    sprintf(buf, "%lu,%lu,%lu,%lu,%lu,%d", (unsigned long)frames, (unsigned long)millis(), (unsigned long)start,
+            (unsigned long)(start - _lastMicros), (unsigned long)(micros() - start), ledsOn);
+    _log->println(buf);
+  }
+  _lastMicros = start;
+}
+
+
+/* color of LED (0xGGRRBB00, with row dimming, like Ws2812) to R, G, B for a screen */
+void LedSim::_getRGB(int x, int y, byte* rgb) {
+  uint32_t color = _palette[dimmedColorIdx(_colorIdx[x * PANEL_ROWS + y], _rowDimming[y])];
+  uint32_t r = (color >> 16) & 0xFF;
+  uint32_t g = (color >> 24) & 0xFF;
+  uint32_t b = (color >> 8) & 0xFF;
+  rgb[0] = min(r * _gain, 255ul);
+  rgb[1] = min(g * _gain, 255ul);
+  rgb[2] = min(b * _gain, 255ul);
+}
+
+
+/* 2 spaces per LED with the LED's color as background. From the 2nd frame on, the cursor first moves up to redraw. */
+void LedSim::_writeAnsi() {
+  char buf[24];
+  byte rgb[3];
+  if (frames > 0) {
+    sprintf(buf, "\x1b[%dA", PANEL_ROWS);
+    _out->print(buf);
+  }
+  for (int y = 0; y < PANEL_ROWS; y++) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      _getRGB(x, y, rgb);
+      sprintf(buf, "\x1b[48;2;%d;%d;%dm  ", rgb[0], rgb[1], rgb[2]);
+      _out->print(buf);
+    }
+    _out->println("\x1b[0m");
+  }
+}
+
+
+void LedSim::_writePpm() {
+  char buf[24];
+  byte rgb[3];
+  sprintf(buf, "P6\n%d %d\n255\n", PANEL_COLS * LEDSIM_PPM_SCALE, PANEL_ROWS * LEDSIM_PPM_SCALE);
+  _out->print(buf);
+  for (int y = 0; y < PANEL_ROWS * LEDSIM_PPM_SCALE; y++) {
+    for (int x = 0; x < PANEL_COLS; x++) {
+      _getRGB(x, y / LEDSIM_PPM_SCALE, rgb);
+      for (int i = 0; i < LEDSIM_PPM_SCALE; i++) _out->write(rgb, 3);
+    }
+  }
+}
@@ -0,0 +1,52 @@
+#ifndef LedSim_h
+#define LedSim_h
+
+#include <Arduino.h>
+#include "LedPanel.h"
+
+#define LEDSIM_ANSI         0    /* frames as ANSI truecolor text (1 line per row, redrawn in place): view in a terminal */
+#define LEDSIM_PPM          1    /* frames as binary PPM images (P6), 1 after another: e.g. ffmpeg -f image2pipe -c:v ppm */
+#define LEDSIM_PPM_SCALE    4    /* pixels (width and height) per LED in PPM images */
+
+/******************************************************************************************************************************
+*
+* CLASS  :  LedSim
+*
+* Simulator of the LED panel (see LEDPANEL_SIMULATOR in HardwDefs.h): instead of writing the LED strips, each frame of
+* LedPanel::writeLeds_asm() is rendered to a stream (any 'Print', e.g. Serial, or stdout on a PC: see tools/LedSimHost,
+* which plays a song with practice 2 or 3 in virtual time). The same color indexes and palette are used as for the LED
+* strips, so global brightness (setGlobalBrightness) and dimming indexes (setRowDimming, COLOR_IDX_xxx + 1..7) look the
+* same as on the panel, only multiplied by 'gain' (screens are darker).
+* Row 0 is the top row, column 0 the lowest piano key.
+* Optionally a timing log is written (CSV, 1 line per frame):  frame,millis,micros,dtMicros,renderMicros,ledsOn
+*
+*******************************************************************************************************************************/
+class LedSim {
+  public:
+    /**
+    * Constructor.
+    */
+    LedSim();
+    void begin(Print* out, byte format, byte gain, Print* log);   /* log may be NULL */
+    void writeFrame(const byte* colorIdx, const uint32_t* palette, const byte* rowDimming); /* by LedPanel::writeLeds_asm() */
+    uint32_t frames;                      /* frames rendered since begin() */
+
+  private:
+    Print* _out;
+    Print* _log;
+    byte _format;
+    byte _gain;
+    uint32_t _lastMicros;                 /* start of last frame */
+
+    const byte* _colorIdx;                /* frame being rendered */
+    const uint32_t* _palette;
+    const byte* _rowDimming;
+
+    void _getRGB(int x, int y, byte* rgb);
+    void _writeAnsi();
+    void _writePpm();
+};
+
+
+
+#endif // LedSim_h
@@ -4,13 +4,15 @@
 #if (METRONOME_HARDWARE_AVAILABLE == true)
 
 const uint32_t _mColors[] PROGMEM =
-{ //GGRRBB00
-  0x00000000,     // color: off
-  0x00800000,     // color: red
-  0x20000000,     // color: green
-  0x0000C000,     // color: blue
+{ //        R     G     B
+  ledColor(0x00, 0x00, 0x00),     // color: off
+  ledColor(0x80, 0x00, 0x00),     // color: red
+  ledColor(0x00, 0x20, 0x00),     // color: green
+  ledColor(0x00, 0x00, 0xC0),     // color: blue
 };
 
+const uint16_t _mLedOrder[] PROGMEM = { 0, 0, 1, 1, 2, 2, 3, 3 };  /* 1 LED strip: both 'lines' of Ws2812 are the same pin */
+
 #define MCOLOR_OFF   0
 #define MCOLOR_RED   1
 #define MCOLOR_GREEN 2
@@ -22,21 +24,12 @@ const uint32_t _mColors[] PROGMEM =
 Metronome::Metronome() {
   _setup_PWM();                                              // PWM (audio pulses) through A3
   
-  pinMode(METRONOME_LEDSTRIP_PIN, OUTPUT);
-  digitalWrite(METRONOME_LEDSTRIP_PIN, LOW);
-
-  _input_for_asm[0] = 0ul;
-  _input_for_asm[1] = 1ul << g_APinDescription[METRONOME_LEDSTRIP_PIN].ulPin;
-  _input_for_asm[2] = _input_for_asm[3] = _input_for_asm[1];  // same, because only 1 LED strip
-  
-  _input_for_asm[4] =  ((uint32_t)(void*)_colorIdx);           // ref. to LED array (4 LEDs)
-  _input_for_asm[5] =  ((uint32_t)(void*)_mColors);            // ref. to color array
-
-  byte port = g_APinDescription[METRONOME_LEDSTRIP_PIN].ulPort;
-  _input_for_asm[6] = (uint32_t)&(PORT->Group[port].OUTCLR.reg);  // store Clr address
-  _input_for_asm[7] = (uint32_t)&(PORT->Group[port].OUTSET.reg);  // store Set address
+  _strip.begin(METRONOME_LEDSTRIP_PIN, METRONOME_LEDSTRIP_PIN, _colorIdx, _mLedOrder);
+  _strip.setPalette(_mColors);
+  _isSharedWrite = false;
 
-  for (int i=0 ; i < 4 ; i++) _colorIdx[i]=0; _writeLeds_asm();        // clear all metronome LEDs
+  for (int i=0 ; i < METRONOME_LEDS ; i++) _colorIdx[i]=0;     // clear all metronome LEDs
+  _isLedsChanged = true; writeLedsNow();
   working = METRONOME_OFF;
 }
 
@@ -96,7 +89,7 @@ void Metronome::startNewMeasure(byte beats, uint32_t millisPerBeat, uint32_t now
   }
 }
 
-void Metronome::handleBeats(uint32_t now) {
+void Metronome::handleBeats(uint32_t now, bool isPanelWriteDue) {
   byte* b; /* bit 0-5 is LED color index,  bit 6+7 have special meaning, see MAUDIO_PULSE, MLED */
   uint32_t actTime;
   
@@ -125,6 +118,15 @@ void Metronome::handleBeats(uint32_t now) {
       }
     }
   }
+  if (_isLedsChanged && !(_isSharedWrite && isPanelWriteDue)) {
+    writeLedsNow();                           /* no LED panel write in this loop to ride along with */
+  }
+}
+
+
+/* Tempo changed while playing: beats that are not yet due come earlier or later (a beat that has started is not changed) */
+void Metronome::scaleBeats(uint32_t now, uint32_t mul, uint32_t div) {
+  _beatsToDo.scaleDelays(now, mul, div);
 }
 
 
@@ -132,6 +134,7 @@ void Metronome::reset() {
   _beatsToDo.reset();
   _setPWM(0, false);
   _setLEDs(0, false);
+  writeLedsNow();
 }
 
 
@@ -142,7 +145,27 @@ void Metronome::_setLEDs(byte ledIdx, bool turnOn) {
   { /* first LED indicates new Measure and has another color. Only 'ledIdx' LED on, other LEDs off */
     _colorIdx[j] = ((j==ledIdx && turnOn) ? (ledIdx==0 ? MCOLOR_BLUE : MCOLOR_GREEN) : MCOLOR_OFF);
   }
-  _writeLeds_asm();
+  _isLedsChanged = true;
+}
+
+
+void Metronome::setSharedWrite(bool isShared) {
+  _isSharedWrite = isShared;
+}
+
+
+void Metronome::writeLeds() {
+  if (!_isLedsChanged) return;
+  _strip.write();
+  _isLedsChanged = false;
+}
+
+
+void Metronome::writeLedsNow() {
+  if (!_isLedsChanged) return;
+  __disable_irq();   // Disable interrupts temporarily because we don't want our pulse timing to be messed up.
+  writeLeds();
+  __enable_irq();
 }
 
 void Metronome::_setPWM(byte ledIdx, bool turnOn) {
@@ -162,107 +185,6 @@ void Metronome::_setPWM(byte ledIdx, bool turnOn) {
 }
 
 
-void Metronome::_writeLeds_asm()
-{ 
-    __disable_irq();   // Disable interrupts temporarily because we don't want our pulse timing to be messed up.
-
-      asm volatile(
-    "LDR  R5, [%[data], #16]   \n"          // R5 = pointer to indexed colors (5 for each piano key), see _input_for_asm[4]
-    
-    "LDR  R1, [%[data], #24]   \n"
-    "MOV  R10, R1              \n"          // R10 = I/O address to drive lines LOW (addrClr), see _input_for_asm[6]
-
-    "LDR  R1, [%[data], #28]   \n"
-    "MOV  R6, R1               \n"          // R6 = I/O address to drive lines HIGH (addrSet), see _input_for_asm[7]
-
-    "LDR  R1, [%[data], #20]   \n"
-    "MOV  R8, R1               \n"          // R8 = pointer to colors-list, see _input_for_asm[5]
-    
-    
-"mainLoop%=:\n"
-    "LDRB R1, [R5, #0]         \n"          // R1=R2 : this way 'writeLED' subroutine is the same as for piano LED panel
-    "MOV  R2, R1               \n"
-    "BL   writeLED%=           \n"          // write LED 1
-    "LDRB R1, [R5, #1]         \n"
-    "MOV  R2, R1               \n"
-    "BL   writeLED%=           \n"          // write LED 2   
-    "LDRB R1, [R5, #2]         \n"
-    "MOV  R2, R1               \n"
-    "BL   writeLED%=           \n"          // write LED 3
-    "LDRB R1, [R5, #3]         \n"
-    "MOV  R2, R1               \n"
-    "BL   writeLED%=           \n"          // write LED 4
-    
-    "B   finished%=            \n"   
-    
-"writeLED%=:\n"                        // looks up two RGB values and writes each of the 24 bits of both to two seperate WS2812B-lines
-    "LSL  R1, R1, #2    \n"            // (line 1) R1 = offset in color table (0, 4, 8, etc)
-    "ADD  R1, R1, R8    \n"            // (line 1) R1 = pointer to the right color (4-byte value)
-    "LDR  R1, [R1]      \n"            // (line 1) R1 is now 24-bit color (coded as 0xGGRRBB00)
-    "LSL  R2, R2, #2    \n"            // (line 2) R2 = offset in color table (0, 4, 8, etc)
-    "ADD  R2, R2, R8    \n"            // (line 2) R2 = pointer to the right color (4-byte value)
-    "LDR  R2, [R2]      \n"            // (line 2) R2 is now 24-bit color (coded as 0xGGRRBB00)
-    
-    "MOV  R0, #24       \n"            // set counter to 24 (for each bit of RGB-color)  
-                                       // (ABOVE LINE DEVIATES FROM THE CORRESPONDING SUBROUTINE TO DRIVE THE PIANO LED PANEL)
-"writeBit%=:\n"  
-    "LDR  R3, [%[data], #12]   \n"     // R3 is pinMask for both lines
-    "STR  R3, [R6]             \n"     // drive both lines HIGH
-
-    "nop\n"                            /* almost no NOPs needed, because of code below */ 
-   
-    ".syntax unified         \n"
-    "LSLS R1, R1, #1         \n"       // shift bit out of R1 (line 1) into carry flag
-    ".syntax divided         \n"
-    "SBC  R4, R4,R4          \n"       // R4=0xFFFFFFFF (if carry==0) or R4=0 (if carry==1)
-    "MOV  R3, #4             \n"
-    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 4 (shifted bit was 0)
-    "MOV  R9, R3             \n"
-    
-    ".syntax unified         \n"
-    "LSLS R2, R2, #1         \n"       // shift bit out of R2 (line 2) into carry flag
-    ".syntax divided         \n"
-    "SBC  R4, R4, R4         \n"       // R4=0xFFFFFFFF (if carry==0) or R4=0 (if carry==1)
-    "MOV  R3, #8             \n"
-    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 8 (shifted bit was 0)
-    "ADD  R3, R3, R9         \n"       // R3 is offset 0, 4, 8 or 12 (to get the right pinMask)
-
-    "LDR  R3, [%[data], R3]  \n"       // R3 = pinMask, for the lines who send 0-bit (must be driven LOW after 0.4us)
-
-    "MOV  R4, R10            \n"       // R4 = addrClr (I/O address to drive lines low)
-    "STR  R3, [R4]           \n"       // drive lines (only lines who send 0-bit) LOW
-    
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up approx. 0.8us */ 
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
-    "nop\n" "nop\n"
-   
-    "LDR  R3, [%[data], #12] \n"       // R3 is pinMask for both lines
-    "STR  R3, [R4]           \n"       // drive all lines low (also lines who send 1-bit, this is after approx. 0.8us)
-
-    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up some time */ 
-    "nop\n" "nop\n"
-     
-    "MOV  R3, #31                   \n"     // mask for counter, because R3 has double counting function
-    "SUB R0, R0, #1                 \n"     // decrease bit-counter by 1
-    ".syntax unified                \n"
-    "ANDS R3, R0, R3                \n"     // are lower 5-bits of counter all zero?
-    ".syntax divided\n"
-
-    "BNE   writeBit%=               \n"     // write another bit while bit-counter >= 1
-    "MOV   PC, LR                   \n"     // return to caller
-
-"finished%=:\n"    
-    :
-    : [data] "r" (_input_for_asm)
-    : "r0", "r1", "r2", "r3", "r4", "r5", "r6", "r8", "r9", "r10", "cc"  /* clobbers */
-    );
-
-    __enable_irq();         // Re-enable interrupts now that we are done.
-    //delayMicroseconds(50);  // Hold the line low for 50 microseconds to send the reset signal. 
-}
-
-
 // 0 coderen: hoog 0.4us, laag 0.85us
 // 1 coderen: hoog 0.8us, laag 0.45us
 // RESET coderen: laag 50us of meer
@@ -274,11 +196,14 @@ void Metronome::_writeLeds_asm()
 Metronome::Metronome() {}
 void Metronome::_setup_PWM(){}
 void Metronome::startNewMeasure(byte beats, uint32_t millisPerBeat, uint32_t now) {}
-void Metronome::handleBeats(uint32_t now) {}
+void Metronome::handleBeats(uint32_t now, bool isPanelWriteDue) {}
+void Metronome::scaleBeats(uint32_t now, uint32_t mul, uint32_t div) {}
 void Metronome::reset() {}
 void Metronome::_setLEDs(byte ledIdx, bool turnOn) {}
 void Metronome::_setPWM(byte ledIdx, bool turnOn) {}
-void Metronome::_writeLeds_asm() {}
+void Metronome::setSharedWrite(bool isShared) {}
+void Metronome::writeLeds() {}
+void Metronome::writeLedsNow() {}
 
 
 #endif // (METRONOME_HARDWARE_AVAILABLE == true)
@@ -4,10 +4,12 @@
 #include <Arduino.h>
 #include "HardwDefs.h"
 #include "Templates.h"
+#include "Ws2812.h"
 
 #define METRONOME_OFF          0
 #define METRONOME_MEASURE_ONLY 1
 #define METRONOME_ALL_BEATS    2
+#define METRONOME_LEDS         4    /* LEDs on the metronome (1 LED strip) */
 
 /*
 *
@@ -17,9 +19,17 @@ class Metronome {
   public:
     Metronome();
     void startNewMeasure(byte beats, uint32_t millisPerBeat, uint32_t now);
-    void handleBeats(uint32_t now);
+    void handleBeats(uint32_t now, bool isPanelWriteDue = false);  /* see setSharedWrite */
+    void scaleBeats(uint32_t now, uint32_t mul, uint32_t div);  /* tempo change: beats after 'now' (see scaleMillis) */
     void reset();
     byte working;
+
+    /* LEDs are written with the same asm routine as the LED panel (Ws2812). With a shared write (see LedPanel::setMetronome)
+    *  changed LEDs are written by the LED panel in the same 'blackout' (interrupts disabled), but only if the player writes
+    *  the LED panel right after handleBeats() (isPanelWriteDue), else at once: a beat is never delayed. */
+    void setSharedWrite(bool isShared);
+    void writeLeds();                        /* if changed: interrupts must be disabled */
+    void writeLedsNow();                     /* if changed: disables interrupts itself (0.12 ms) */
   protected:
 
   private:
@@ -27,9 +37,10 @@ class Metronome {
     void _setLEDs(byte ledIdx, bool turnOn);
     void _setPWM(byte ledIdx, bool turnOn);
   
-    unsigned char _colorIdx[4];              /* colors (indexes) of each LED on metronome */
-    void _writeLeds_asm();
-    uint32_t _input_for_asm[8];              /* 8-byte structure to pass data to asm routine */
+    unsigned char _colorIdx[METRONOME_LEDS]; /* colors (indexes) of each LED on metronome */
+    Ws2812Strips<1, METRONOME_LEDS> _strip;
+    bool _isLedsChanged;                     /* _colorIdx changed, not yet written */
+    bool _isSharedWrite;
 
     DelayManager<byte, 32> _beatsToDo;       /* metronome beats to process in the future. */
 };
@@ -1,4 +1,6 @@
 #include "Midi.h"
+#include "Recorder.h"
+#include "LatencyProbe.h"
 
 
 
@@ -12,6 +14,13 @@
 
 
 MidiInterface::MidiInterface() {
+  _recorder = NULL;
+  _latencyProbe = NULL;
+  _lastByteMicros = 0;
+  _rxStatus = 0;
+  _rxMissing = 0;
+  _lastPressedKey = 0;
+  resetLinkStats();
 }
 
 void MidiInterface::init_MIDI() {
@@ -49,12 +58,55 @@ void MidiInterface::handleAllDelaysImmediately() {
   }
 }
 
+/* Tempo changed while playing: notes that sound end earlier or later */
+void MidiInterface::scaleDelays(uint32_t now, uint32_t mul, uint32_t div) {
+  _noteOffs_todo.scaleDelays(now, mul, div);
+}
+
 /* Send ProgramChange MIDI message to Piano to change the instrument (using the USB Host Controller connected to Serial1) */
 void MidiInterface::selectInstrument(byte instrument) {
   Serial1.write(MidiType::ProgramChange + MIDI_SEND_CHANNEL);
   Serial1.write(instrument & 0b01111111);
 }
 
+/* Send System Real Time MIDI message (Clock, Start, Continue, Stop): a single byte without channel */
+void MidiInterface::sendRealTime(byte type) {
+  Serial1.write(type);
+}
+
+/******************************************************************************************************************************
+* Measure the round-trip time (milliseconds) of a note sent to the piano, that the piano echoes back (MIDI thru).
+* A very soft note is sent MIDI_ECHO_PINGS times, the median is returned. Returns -1 if the piano does not echo.
+*******************************************************************************************************************************/
+int MidiInterface::measureEchoRoundTrip() {
+  uint16_t roundTrip[MIDI_ECHO_PINGS];
+  for (int i = 0; i < MIDI_ECHO_PINGS; i++) {
+    clearReadBuffer();
+    bool isNoteOn = false;   /* last byte was NoteOn status (any channel)? */
+    bool echoed = false;
+    uint32_t start = micros();
+    _noteOn(MIDI_ECHO_PITCH, 1);
+    while (!echoed && micros() - start < MIDI_ECHO_TIMEOUT * 1000ul) {
+      if (Serial1.available() == 0) continue;
+      int b = Serial1.read();
+      if (b >= MidiType::Clock) continue;                    /* real-time message: ignore */
+      echoed = (isNoteOn && b == MIDI_ECHO_PITCH);
+      isNoteOn = ((b & 0xF0) == MidiType::NoteOn);
+    }
+    uint32_t end = micros();
+    _noteOff(MIDI_ECHO_PITCH);
+    if (!echoed) return -1;
+    /* insertion sort, to find the median later */
+    uint16_t t = (end - start + 500) / 1000;
+    int j = i;
+    while (j > 0 && roundTrip[j-1] > t) { roundTrip[j] = roundTrip[j-1]; j--; }
+    roundTrip[j] = t;
+    delay(50);                                               /* let note off (and its echo) pass */
+  }
+  clearReadBuffer();
+  return roundTrip[MIDI_ECHO_PINGS / 2];
+}
+
 /* Send NoteOn MIDI message to Piano (using the USB Host Controller connected to Serial1) */
 void MidiInterface::_noteOn(byte pitch, byte velocity) {
   Serial1.write(MidiType::NoteOn + MIDI_SEND_CHANNEL);
@@ -79,14 +131,18 @@ void MidiInterface::_noteOff(byte pitch) {
 int MidiInterface::getPressedPianoKey() {
   static int waitForBytes = 3;  /* example MIDI message: 0x90-0x60-0x040 (NoteOn-pitchC2-velocity64) */
   static int pitch;
-  while (Serial1.available() > 0) 
+  _checkReceiveBuffer();
+  while (_available() > 0) 
   {
-    int b = Serial1.read();
+    int b = _read();
+    if (b >= MidiType::Clock) continue;                       /* real-time message (can be in between bytes of other message) */
+    if ((b & 0x80) && waitForBytes < 3) { resyncs++; waitForBytes = 3; }  /* status byte, while message was not complete */
     if (b == MidiType::NoteOn) { waitForBytes = 2; }          /* note-on detected, now wait for 2 more bytes */
     else if (waitForBytes == 2) { pitch = b; waitForBytes--; }/* piano key (pitch) stored, now wait for velocity */
     else if (waitForBytes == 1) {  /* third byte must be >0, otherwise it is 'note-off' message */
       waitForBytes = 3;
       if (b > 0) {
+        _lastPressedKey = 0;  /* taken here (see takeLastPressedKey) */
         return pitch;     /* yes, velocity is >0, now we know the piano key (pitch) that was pressed */
       }
     }
@@ -100,9 +156,12 @@ int MidiInterface::getPressedPianoKey(bool *sustainPressed, bool* sustainRelease
   static int pitch;
   static int bFirst;
   *sustainPressed = *sustainReleased = false;
-  while (Serial1.available() > 0) 
+  _checkReceiveBuffer();
+  while (_available() > 0) 
   {
-    int b = Serial1.read();
+    int b = _read();
+    if (b >= MidiType::Clock) continue;   /* real-time message (can be in between bytes of other message) */
+    if ((b & 0x80) && waitForBytes < 3) { resyncs++; waitForBytes = 3; }  /* status byte, while message was not complete */
     if (b == MidiType::NoteOn || b == MidiType::ControlChange) { bFirst = b; waitForBytes = 2; }          /* note-on detected, now wait for 2 more bytes */
     else if (waitForBytes == 2)
     {
@@ -120,7 +179,7 @@ int MidiInterface::getPressedPianoKey(bool *sustainPressed, bool* sustainRelease
       waitForBytes = 3;
       if (bFirst == MidiType::NoteOn) 
       { 
-        if (b > 0) return pitch;
+        if (b > 0) { _lastPressedKey = 0; return pitch; }  /* taken here (see takeLastPressedKey) */
       }
       else if (bFirst == MidiType::ControlChange) 
       {
@@ -136,4 +195,146 @@ int MidiInterface::getPressedPianoKey(bool *sustainPressed, bool* sustainRelease
 
 void MidiInterface::clearReadBuffer() {
   while (Serial1.available() > 0) Serial1.read();
+#ifdef MIDI_INJECT
+  _injected.reset();
+#endif
+  _rxMissing = 0;
+  _lastPressedKey = 0;
+}
+
+/* Return first System Real Time byte (MIDI clock etc.) that was received, or 0 if none. Other bytes are ignored. */
+byte MidiInterface::readRealTime() {
+  _checkReceiveBuffer();
+  while (_available() > 0) {
+    int b = _read();
+    if (b >= MidiType::Clock) return b;
+  }
+  return 0;
+}
+
+void MidiInterface::setRecorder(Recorder* r) {
+  _recorder = r;
+}
+
+void MidiInterface::setLatencyProbe(LatencyProbe* p) {
+  _latencyProbe = p;
+}
+
+#ifdef MIDI_INJECT
+/* Test: 'b' is read before the bytes received from Serial1, so key presses can be simulated (see test_KeyToLedLatency) */
+void MidiInterface::injectByte(byte b) {
+  if (_injected.count() >= MIDI_INJECT_MAX - 1) return;  /* full */
+  *_injected.add() = b;
+}
+
+int MidiInterface::_available() {
+  return _injected.count() + Serial1.available();
+}
+
+/* Read 1 received byte (injected bytes first), and pass it to the recorder and latency probe (if any) */
+int MidiInterface::_read() {
+  int b;
+  byte* injected = _injected.getFirst();
+  if (injected != NULL) {
+    b = *injected;
+    _injected.removeFirst();
+  }
+  else {
+    b = Serial1.read();
+  }
+#else
+int MidiInterface::_available() {
+  return Serial1.available();
+}
+
+/* Read 1 received byte, and pass it to the recorder and latency probe (if any) */
+int MidiInterface::_read() {
+  int b = Serial1.read();
+#endif
+  if (_recorder != NULL) _recorder->receiveByte(b);
+  if (_latencyProbe != NULL) _latencyProbe->receiveByte(b);
+  _trackMessage(b);
+  return b;
+}
+
+
+/******************************************************************************************************************************
+*
+* HEALTH OF THE MIDI LINK
+* 
+*******************************************************************************************************************************/
+
+/* Read (and clear) error flags of the UART. Must be called while interrupts are disabled: otherwise the UART interrupt
+   handler of the Arduino core may clear the flags first. LedPanel::writeLeds_asm() calls this, because that is exactly
+   when the UART cannot be read in time. */
+void MidiInterface::checkLinkStatus() {
+  uint16_t status = MIDI_SERCOM->USART.STATUS.reg;
+  if (status & SERCOM_USART_STATUS_BUFOVF) overruns++;
+  if (status & SERCOM_USART_STATUS_FERR) framingErrors++;
+  MIDI_SERCOM->USART.STATUS.reg = status & (SERCOM_USART_STATUS_BUFOVF | SERCOM_USART_STATUS_FERR);  /* write 1 to clear */
+}
+
+void MidiInterface::resetLinkStats() {
+  overruns = 0;
+  framingErrors = 0;
+  resyncs = 0;
+  bufferFullEvents = 0;
+}
+
+/* Full receive buffer: the Arduino core drops bytes that arrive now (how many is not known, only counted once per check) */
+void MidiInterface::_checkReceiveBuffer() {
+  if (Serial1.available() >= SERIAL_BUFFER_SIZE - 1) bufferFullEvents++;
+}
+
+
+/******************************************************************************************************************************
+*
+* ACTIVITY OF THE MIDI LINK
+* 
+*******************************************************************************************************************************/
+
+bool MidiInterface::isReceiving() {
+  if (_available() > 0) return true;
+  if (_rxMissing > 0 && micros() - _lastByteMicros >= MIDI_RX_TIMEOUT_MICROS) _rxMissing = 0;  /* rest lost (or no F7) */
+  return _rxMissing > 0;
+}
+
+/* Bytes are timestamped when they are read (not when received), so this is the worst case */
+uint32_t MidiInterface::getMicrosSinceLastByte() {
+  return micros() - _lastByteMicros;
+}
+
+/* Keep track of the data bytes still missing of the message being received (running status supported), and of the last
+   piano key pressed (see takeLastPressedKey) */
+void MidiInterface::_trackMessage(byte b) {
+  _lastByteMicros = micros();
+  if (b >= MidiType::Clock) return;                             /* real-time message (1 byte) */
+  if (b == 0xF7) { _rxMissing = 0; return; }                    /* end of SysEx */
+  if (b & 0x80) {                                               /* status byte */
+    _rxStatus = (b < MidiType::SystemExclusive) ? b : 0;        /* system messages have no running status */
+    _rxMissing = _getDataBytes(b);
+    return;
+  }
+  if (_rxMissing == MIDI_RX_SYSEX) return;
+  if (_rxMissing > 0) _rxMissing--;
+  else if (_rxStatus != 0) _rxMissing = _getDataBytes(_rxStatus) - 1;  /* running status: 1st data byte of new message */
+  if (_rxStatus == MidiType::NoteOn) {                          /* piano key: pitch, then velocity (0 means note-off) */
+    if (_rxMissing == 1) _rxPitch = b;
+    else if (b > 0) _lastPressedKey = _rxPitch;
+  }
+}
+
+int MidiInterface::takeLastPressedKey() {
+  int pitch = _lastPressedKey;
+  _lastPressedKey = 0;
+  return pitch;
+}
+
+byte MidiInterface::_getDataBytes(byte status) {
+  if (status == MidiType::SystemExclusive) return MIDI_RX_SYSEX;
+  if (status == MidiType::TimeCodeQuarterFrame || status == MidiType::SongSelect) return 1;
+  if (status == MidiType::SongPosition) return 2;
+  if (status >= MidiType::SystemExclusive) return 0;
+  byte type = status & 0xF0;
+  return (type == MidiType::ProgramChange || type == MidiType::AfterTouchChannel) ? 1 : 2;
 }
@@ -4,10 +4,20 @@
 #include <Arduino.h>
 #include "MidiDefs.h"
 #include "Templates.h"
+#include "HardwDefs.h"
 
 
 #define MIDI_SEND_CHANNEL      2    /* MIDI channel used for playing notes (low nibble of NoteOn/NoteOff MIDI messages)  */
 #define MIDI_MAX_DELAYED_MSG  20    /* max amount of MIDI messages (noteOff) that the system should be able to delay */
+#define MIDI_ECHO_PITCH       MIDI_PITCH_C7  /* note sent (very soft) to measure round-trip time of MIDI echo */
+#define MIDI_ECHO_PINGS       8     /* how many times to measure the round-trip time (median is used) */
+#define MIDI_ECHO_TIMEOUT     200   /* milliseconds to wait for echo */
+#define MIDI_INJECT_MAX       32    /* MIDI_INJECT: bytes that can be injected (see injectByte) */
+#define MIDI_RX_SYSEX         0xFF  /* data bytes missing: unknown, until end of SysEx */
+#define MIDI_RX_TIMEOUT_MICROS 1000 /* half received message (or SysEx without end) is given up after this silence */
+
+class Recorder;
+class LatencyProbe;
 
 /******************************************************************************************************************************
 *
@@ -27,15 +37,53 @@ class MidiInterface {
     void playNote(byte pitch, byte velocity, uint32_t noteOffTime);
     void handleDelays(uint32_t now);
     void handleAllDelaysImmediately();
+    void scaleDelays(uint32_t now, uint32_t mul, uint32_t div);  /* tempo change: note-offs after 'now' (see scaleMillis) */
     void selectInstrument(byte instrument);
+    void sendRealTime(byte type);
+    int measureEchoRoundTrip();
 
     /* reading MIDI messages */
     int getPressedPianoKey();
     int getPressedPianoKey(bool *sustainPressed, bool* sustainReleased);
     void clearReadBuffer();
+    byte readRealTime();
+    int takeLastPressedKey();        /* last piano key pressed since previous call, not taken by getPressedPianoKey(), or 0 */
+    void setRecorder(Recorder* r);   /* every byte received from the piano is also passed to this recorder */
+    void setLatencyProbe(LatencyProbe* p);  /* instrumentation: every byte received is also passed to this probe */
+#ifdef MIDI_INJECT
+    void injectByte(byte b);         /* test: byte is read as if it was received from the piano (before bytes from Serial1) */
+#endif
+
+    /* health of the MIDI link (bytes lost while interrupts were disabled, e.g. by LedPanel::writeLeds_asm()) */
+    void checkLinkStatus();          /* read and clear UART error flags: call while interrupts are disabled */
+    void resetLinkStats();
+    uint16_t overruns;               /* UART receive buffer overflow (BUFOVF): byte(s) lost */
+    uint16_t framingErrors;          /* UART framing error (FERR): byte corrupted */
+    uint16_t resyncs;                /* parser got a status byte in the middle of a message: message lost */
+    uint16_t bufferFullEvents;       /* receive buffer of Serial1 found full (times, not bytes): byte(s) may be lost */
+
+    /* activity of the MIDI link (see FrameScheduler: LED panel is written in safe gaps) */
+    bool isReceiving();              /* bytes waiting in receive buffer, or MIDI message half received (MIDI_RX_TIMEOUT_MICROS) */
+    uint32_t getMicrosSinceLastByte();
 
   private:
     DelayManager<byte, MIDI_MAX_DELAYED_MSG> _noteOffs_todo;       /* MIDI noteOff messages to be sent in the future */
+    Recorder* _recorder;
+    LatencyProbe* _latencyProbe;
+#ifdef MIDI_INJECT
+    CircularArray<byte, MIDI_INJECT_MAX> _injected;             /* bytes injected by a test, not yet read */
+#endif
+    uint32_t _lastByteMicros;        /* time last byte was read */
+    byte _rxStatus;                  /* status of last channel message (running status), 0 if none */
+    byte _rxMissing;                 /* data bytes still missing of current message (MIDI_RX_SYSEX: in SysEx) */
+    byte _rxPitch;                   /* 1st data byte of current NoteOn message */
+    byte _lastPressedKey;            /* see takeLastPressedKey */
+
+    int _available();
+    int _read();
+    void _checkReceiveBuffer();
+    void _trackMessage(byte b);
+    byte _getDataBytes(byte status);
 
     void _noteOn(byte pitch, byte velocity);
     void _noteOff(byte pitch);
@@ -0,0 +1,267 @@
+#include "MidiClock.h"
+#include "Midi.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  MidiClock
+*
+*******************************************************************************************************************************
+* Master mode:
+*  The Player tells at the start of every measure what the tempo is (newMeasure). At that time a clock is sent, and
+*  thereafter every 1/24 quarter note. So clocks never drift away from the song's tick timeline, also when tempo changes.
+* Slave mode:
+*  Incoming clocks are timestamped when they are read (which can be a few milliseconds late, e.g. while the LED panel is
+*  written). A simple phase-locked loop filters this jitter: the time of the next clock is predicted, and the difference
+*  with the actual time (error) corrects both phase (time of last clock) and period (time between clocks).
+*  Clock 0 is the first clock after Start (or the first clock at all). The Player converts song ticks to clocks and asks
+*  when that clock is (getMillisAtTick), so the song stays locked to the external device, also when its tempo changes.
+*  Tick 0 of the song is clock 0: the song is scheduled from clock 0 on (no count-in). Until the estimate is locked
+*  (MIDI_CLOCK_LOCK_CLOCKS), the period is provisional: the song's tempo at clock 0, the average since clock 0 thereafter.
+*******************************************************************************************************************************/
+
+
+MidiClock::MidiClock(MidiInterface* mi) {
+  _midi = mi;
+  mode = MIDI_CLOCK_OFF;
+  missedClocks = 0;
+  _running = false;
+  _startPending = false;
+  _clockCount = 0;
+  _stopped = false;
+  _continuePending = false;
+  _periodMicros = 0;
+  setNominalTempo(MIDI_CLOCK_NOMINAL_TEMPO);
+}
+
+
+/******************************************************************************************************************************
+* Song (re)starts. Master: Start is sent together with the first clock (at start of first measure).
+*******************************************************************************************************************************/
+void MidiClock::startSong() {
+  _anchors.reset();
+  _running = false;
+  _startPending = (mode == MIDI_CLOCK_MASTER);
+  if (mode == MIDI_CLOCK_SLAVE) {
+    _midi->clearReadBuffer(); /* ignore old clocks (not read while not playing) */
+    _clockCount = 0;       /* next clock will be clock 0 */
+    _stopped = false;
+    _continuePending = false;
+    missedClocks = 0;
+  }
+}
+
+/******************************************************************************************************************************
+* Master: a measure starts at 'atMillis' with 'tempo' (ms per quarter note). Called ahead of time, when measure is scheduled.
+*******************************************************************************************************************************/
+void MidiClock::newMeasure(uint32_t atMillis, unsigned int tempo) {
+  if (mode != MIDI_CLOCK_MASTER) return;
+  _anchors.add(tempo, atMillis);
+}
+
+
+/******************************************************************************************************************************
+* Must be called constantly while playing. Master: send clocks that are due. Slave: read incoming clocks.
+* In all modes the received bytes are read, so they can be recorded (see Recorder).
+*******************************************************************************************************************************/
+void MidiClock::handleClock(uint32_t nowCorr) {
+  byte b;
+  while ( (b = _midi->readRealTime()) != 0) {  /* always read: piano keys (not used by Player2/3) are passed to the recorder */
+    if (mode == MIDI_CLOCK_SLAVE) receiveRealTime(b, nowCorr);
+  }
+  if (mode != MIDI_CLOCK_MASTER) return;
+  uint32_t atMillis;
+  unsigned int* tempo;
+  while ( (tempo = _anchors.peekFirst(atMillis)) != NULL) {
+    if (atMillis > nowCorr) break; /* not yet time for next measure */
+    /* new measure starts: align clocks with start of measure and continue with tempo of this measure */
+    _anchorMillis = atMillis;
+    _nextClockMicros = 0;
+    _periodMicros = (uint32_t)*tempo * 1000 / MIDI_CLOCK_PPQN;
+    _running = true;
+    _anchors.removeFirst();
+  }
+  if (!_running) return;
+  if ((int32_t)(nowCorr - _anchorMillis) < 0) return;  /* anchor is shifted into the future (resume adds 100 ms extra) */
+  while ((nowCorr - _anchorMillis) * 1000 >= _nextClockMicros) {
+    if (_startPending) {
+      _midi->sendRealTime(MidiType::Start);
+      _startPending = false;
+    }
+    _midi->sendRealTime(MidiType::Clock);
+    _nextClockMicros += _periodMicros;
+  }
+}
+
+
+void MidiClock::stopSong() {
+  if (mode == MIDI_CLOCK_MASTER && !_startPending) _midi->sendRealTime(MidiType::Stop);
+  _running = false;
+  _startPending = false;
+  _anchors.reset();
+}
+
+
+/******************************************************************************************************************************
+* Master: song is paused/continued (with foot pedal). In slave mode the external device decides, so nothing to do.
+*******************************************************************************************************************************/
+void MidiClock::suspend() {
+  if (mode == MIDI_CLOCK_MASTER && !_startPending) _midi->sendRealTime(MidiType::Stop);
+}
+
+void MidiClock::resume(uint32_t dMillis) {
+  if (mode != MIDI_CLOCK_MASTER) return;
+  _anchorMillis += dMillis;
+  _anchors.addSuspendedMillis(dMillis);
+  if (!_startPending) _midi->sendRealTime(MidiType::Continue);
+}
+
+
+/******************************************************************************************************************************
+* Master: the tempo factor changed while playing. Clocks continue from 'nowCorr' with the new period (the next clock keeps
+* its place within the current period), upcoming measure starts and their tempo are changed the same way (see scaleMillis).
+*******************************************************************************************************************************/
+void MidiClock::scaleTempo(uint32_t nowCorr, uint32_t mul, uint32_t div) {
+  if (mode != MIDI_CLOCK_MASTER) return;
+  if (_running && nowCorr >= _anchorMillis) {
+    uint32_t passedMicros = (nowCorr - _anchorMillis) * 1000;
+    uint32_t leftMicros = (_nextClockMicros > passedMicros) ? _nextClockMicros - passedMicros : 0;
+    _anchorMillis = nowCorr;
+    _nextClockMicros = leftMicros * mul / div;
+    _periodMicros = _periodMicros * mul / div;
+  }
+  DelayManager<unsigned int, MIDI_CLOCK_ANCHORS_MAX> anchors = _anchors;
+  _anchors.reset();
+  uint32_t atMillis;
+  unsigned int* tempo;
+  while ( (tempo = anchors.peekFirst(atMillis)) != NULL) {
+    _anchors.add(*tempo * mul / div, scaleMillis(atMillis, nowCorr, mul, div));
+    anchors.removeFirst();
+  }
+}
+
+
+/******************************************************************************************************************************
+* Slave: handle a System Real Time byte. Public, so a recorded clock stream can be replayed (see test_MidiClock).
+*******************************************************************************************************************************/
+void MidiClock::receiveRealTime(byte b, uint32_t nowCorr) {
+  switch (b) {
+    case MidiType::Start:
+      _clockCount = 0;          /* next clock will be clock 0 */
+      _stopped = false;
+      _continuePending = false;
+      break;
+    case MidiType::Continue:
+      _continuePending = _stopped;
+      _stopped = false;
+      break;
+    case MidiType::Stop:
+      _stopped = true;
+      break;
+    case MidiType::Clock:
+      _receiveClock(nowCorr);
+      break;
+  }
+}
+
+
+void MidiClock::_receiveClock(uint32_t nowCorr) {
+  if (_clockCount == 0) {  /* clock 0 */
+    _baseMillis = nowCorr;
+    _phaseMicros = 0;
+    _periodMicros = _nominalPeriodMicros;  /* provisional, until clock 1 */
+    _clockCount = 1;
+    return;
+  }
+  int32_t t = (int32_t)(nowCorr - _baseMillis) * 1000;  /* microseconds after _baseMillis */
+  if (_continuePending) {
+    /* first clock after pause: period is still valid, only phase must be set again */
+    _phaseMicros = t;
+    _continuePending = false;
+  }
+  else if (_clockCount < MIDI_CLOCK_LOCK_CLOCKS) {
+    /* locking: average period since clock 0 */
+    _periodMicros = t / _clockCount;
+    _phaseMicros = t;
+  }
+  else {
+    /* locked: predict time of this clock and correct phase and period with a part of the error */
+    int32_t predicted = _phaseMicros + (int32_t)_periodMicros;
+    int32_t err = t - predicted;
+    while (_periodMicros > 0 && err > (int32_t)(_periodMicros * 3 / 4)) { /* much too late: one or more clocks never arrived */
+      predicted += _periodMicros;
+      err -= _periodMicros;
+      _clockCount++;
+      missedClocks++;
+    }
+    _phaseMicros = predicted + err / MIDI_CLOCK_PHASE_GAIN;
+    _periodMicros += err / MIDI_CLOCK_PERIOD_GAIN;
+    int32_t ms = _phaseMicros / 1000;   /* keep _phaseMicros small, so no overflow for long songs */
+    _baseMillis += ms;
+    _phaseMicros -= ms * 1000;
+  }
+  _clockCount++;
+}
+
+
+/******************************************************************************************************************************
+* Slave: the song's tempo (ms per quarter note), so the notes after clock 0 can be scheduled before clock 1 is received
+*******************************************************************************************************************************/
+void MidiClock::setNominalTempo(unsigned int tempo) {
+  _nominalPeriodMicros = (uint32_t)tempo * 1000 / MIDI_CLOCK_PPQN;
+  if (mode == MIDI_CLOCK_SLAVE && _clockCount == 1) _periodMicros = _nominalPeriodMicros;  /* only clock 0 received */
+}
+
+
+/******************************************************************************************************************************
+* Slave: true if external device started (clock 0 received)
+*******************************************************************************************************************************/
+bool MidiClock::isClockStarted() {
+  return (mode == MIDI_CLOCK_SLAVE && _clockCount > 0);
+}
+
+
+/******************************************************************************************************************************
+* Slave: true if the song can follow the external clock: from clock 0 on (provisional period while locking, see above)
+*******************************************************************************************************************************/
+bool MidiClock::isFollowing() {
+  return (mode == MIDI_CLOCK_SLAVE && !_stopped && _clockCount > 0);
+}
+
+
+/******************************************************************************************************************************
+* Slave: true if the estimate of period and phase is locked (the filter is used, not the average since clock 0)
+*******************************************************************************************************************************/
+bool MidiClock::isLocked() {
+  return (isFollowing() && _clockCount >= MIDI_CLOCK_LOCK_CLOCKS);
+}
+
+
+/******************************************************************************************************************************
+* Slave: estimated tempo in milliseconds per quarter note (as used by _setTempo() in Player2 and Player3)
+*******************************************************************************************************************************/
+unsigned int MidiClock::getTempo() {
+  return (_periodMicros * MIDI_CLOCK_PPQN + 500) / 1000;
+}
+
+
+/******************************************************************************************************************************
+* Slave: when is clock 'clockNr'? Can be in the past or in the future (then it is predicted).
+*******************************************************************************************************************************/
+uint32_t MidiClock::getMillisAtClock(uint32_t clockNr) {
+  return getMillisAtTick(clockNr, MIDI_CLOCK_PPQN);
+}
+
+
+/******************************************************************************************************************************
+* Slave: when is the song 'ticks' after clock 0 (ticks may be in between 2 clocks)?
+*******************************************************************************************************************************/
+uint32_t MidiClock::getMillisAtTick(uint32_t ticks, uint32_t resolution) {
+  uint32_t clockNr = ticks * MIDI_CLOCK_PPQN / resolution;
+  uint32_t rest = ticks * MIDI_CLOCK_PPQN % resolution;          /* part of a clock, in 1/resolution clocks */
+  int32_t dClocks = (int32_t)(clockNr - (_clockCount - 1));     /* clocks after last received clock */
+  int32_t t = _phaseMicros + dClocks * (int32_t)_periodMicros + (int32_t)(rest * _periodMicros / resolution);
+  if (t >= 0) return _baseMillis + (t + 500) / 1000;            /* round to milliseconds */
+  return _baseMillis - (500 - t) / 1000;
+}
@@ -0,0 +1,82 @@
+#ifndef MidiClock_h
+#define MidiClock_h
+
+#include <Arduino.h>
+#include "MidiDefs.h"
+#include "Templates.h"
+
+
+#define MIDI_CLOCK_OFF           0    /* no MIDI clock: tempo only from song and tempo-factor */
+#define MIDI_CLOCK_MASTER        1    /* send MIDI Clock/Start/Stop, derived from the song's tick timeline */
+#define MIDI_CLOCK_SLAVE         2    /* follow incoming MIDI Clock: tempo and position locked to external device */
+
+#define MIDI_CLOCK_PPQN          24   /* MIDI clocks per quarter note (fixed by MIDI specification) */
+#define MIDI_CLOCK_LOCK_CLOCKS   24   /* slave: clocks to receive before the estimate is locked (1 quarter note) */
+#define MIDI_CLOCK_NOMINAL_TEMPO 500  /* slave: ms per quarter note until the song's tempo is known (120 QPM) */
+#define MIDI_CLOCK_PHASE_GAIN    8    /* slave: phase correction = 1/8 of error (higher is smoother, but slower) */
+#define MIDI_CLOCK_PERIOD_GAIN   64   /* slave: period correction = 1/64 of error */
+#define MIDI_CLOCK_ANCHORS_MAX   4    /* master: how many upcoming tempo changes (1 per measure) can be stored in DelayManager? */
+
+class MidiInterface;
+
+/******************************************************************************************************************************
+*
+* CLASS  :  MidiClock
+*
+* Master: sends MIDI Clock (24 per quarter note), Start, Stop and Continue, so other devices can follow the song.
+* Slave:  reads incoming MIDI Clock and estimates tempo and phase (phase-locked loop), so the song can follow another device.
+* All times are 'nowCorr' values of the Player (milliseconds, corrected for missed interrupts).
+*
+*******************************************************************************************************************************/
+class MidiClock {
+  public:
+    /**
+    * Constructor.
+    */
+    MidiClock(MidiInterface* mi);
+    void startSong();                                      /* song (re)starts: master sends Start with the first clock */
+    void newMeasure(uint32_t atMillis, unsigned int tempo);/* master: (new) tempo in ms per quarter note from 'atMillis' */
+    void handleClock(uint32_t nowCorr);                    /* master: send clocks that are due, slave: read incoming clocks */
+    void stopSong();                                       /* master: send Stop */
+    void suspend();                                        /* master: send Stop, clocks are paused */
+    void resume(uint32_t dMillis);                         /* master: send Continue, shift timeline by dMillis */
+    void scaleTempo(uint32_t nowCorr, uint32_t mul, uint32_t div); /* master: tempo change, clock period * mul/div */
+    void receiveRealTime(byte b, uint32_t nowCorr);        /* slave: handle MIDI real-time byte (Clock, Start, Stop) */
+    void setNominalTempo(unsigned int tempo);              /* slave: tempo of the song (ms per quarter note), used from
+                                                              clock 0 until clock 1 gives the first measured period */
+
+    /* slave: estimated (phase-locked) timeline */
+    bool isClockStarted();                                 /* true if mode is slave and clock 0 was received */
+    bool isFollowing();                                    /* true if mode is slave and clock 0 was received (not stopped) */
+    bool isLocked();                                       /* true if following and MIDI_CLOCK_LOCK_CLOCKS were received */
+    unsigned int getTempo();                               /* milliseconds per quarter note */
+    uint32_t getMillisAtTick(uint32_t ticks, uint32_t resolution); /* time when 'ticks' after clock 0 is reached */
+    uint32_t getMillisAtClock(uint32_t clockNr);           /* time of clock 'clockNr' (0 = first clock after Start) */
+
+    byte mode;                                             /* MIDI_CLOCK_OFF, MIDI_CLOCK_MASTER or MIDI_CLOCK_SLAVE */
+    uint16_t missedClocks;                                 /* slave: clocks that never arrived (e.g. UART overrun) */
+
+  private:
+    MidiInterface* _midi;
+    /* master */
+    bool _running;                  /* are clocks being sent? */
+    bool _startPending;             /* send Start before next clock? */
+    uint32_t _anchorMillis;         /* time (ms) of last anchor (measure start) */
+    uint32_t _nextClockMicros;      /* time of next clock, in microseconds after _anchorMillis */
+    uint32_t _periodMicros;         /* time between 2 clocks in microseconds (master and slave) */
+    uint32_t _nominalPeriodMicros;  /* slave: period of the song's tempo, until a period is measured */
+    DelayManager<unsigned int, MIDI_CLOCK_ANCHORS_MAX> _anchors;  /* upcoming measure starts with their tempo (ms per quarter note) */
+    /* slave */
+    uint32_t _clockCount;           /* how many clocks received since Start? */
+    uint32_t _baseMillis;           /* time of clock 0 while locking, thereafter moves forward to keep _phaseMicros small */
+    int32_t  _phaseMicros;          /* estimated time of last clock, in microseconds after _baseMillis */
+    bool _stopped;                  /* Stop received: timeline is not valid until Continue */
+    bool _continuePending;          /* Continue received: next clock follows after a pause */
+
+    void _receiveClock(uint32_t nowCorr);
+};
+
+
+
+
+#endif // MidiClock_h
@@ -0,0 +1,491 @@
+#ifndef Playback_h
+#define Playback_h
+
+#include <Arduino.h>
+#include "Templates.h"
+#include "Entities.h"
+#include "Metronome.h"
+#include "Gloves.h"
+#include "Midi.h"
+#include "MidiClock.h"
+
+#define PLAYBACK_LOOK_AHEAD      1     /* policy: notes are scheduled ahead of time (upcoming notes, latency compensation) */
+#define PLAYBACK_MIDI_CLOCK      2     /* policy: send MIDI clocks (master) or follow an external MIDI clock (slave) */
+#define PLAYBACK_GLOVES          4     /* policy: vibrating motors of the gloves follow the fingers of the notes */
+#define PLAYBACK_METRONOME       8     /* policy: metronome beats for each measure */
+
+#define UPCOMING_NOTES_MAX       50    /* how many 'upcoming' notes can be stored in CircularArray? */
+#define UPCOMING_MEASURES_MAX    4     /* how many 'upcoming' measures can be stored in DelayManager? */
+#define GLOVE_COMMANDS_MAX       60    /* how many glove-commands (eg.: 'finger 8 ON') can be stored in DelayManager? */
+#define PLAYBACK_END_MILLIS      100   /* song is finished 100 ms after the 'real' end time of the song */
+#define PLAYBACK_METRONOME_DELAY 3     /* without look-ahead: metronome starts 3 ms after the measure is handled */
+
+#define GLOVE_FINGER_ON          128   /* bit-7 is 1 means: turn glove-finger ON */
+#define GLOVE_FINGER_OFF         0     /* bit-7 is 0 means: turn glove-finger OFF */
+
+
+
+/******************************************************************************************************************************
+*
+*  TEMPLATE  :  Playback
+*
+*  The timeline of a song, shared by Player0, Player2 and Player3: ticks to milliseconds (tempo per measure, tempo factor,
+*  external MIDI clock), end of song, repeat and A-B loop, measures (measure-nr, metronome, MIDI clock) and for each note the time to
+*  start it. A player derives from Playback<player, policies> and only does its own LED presentation in:
+*      void _startNote(SongNote* note, uint32_t durationMillis, uint32_t nowCorr);   (Playback must be a friend)
+*  Policies (FLAGS, see PLAYBACK_xxx) are known at compile time, so code of policies not used is left out (and smaller
+*  arrays are used), and _startNote() can be inlined.
+*  Without PLAYBACK_LOOK_AHEAD: _startNote() is called as soon as the note is due (from _scheduleNext).
+*  With PLAYBACK_LOOK_AHEAD: notes are put in _upcomingArray '_timeAhead' milliseconds before they are due (so the player
+*  can show them in advance), the piano (auto-play) and the gloves are served early by their latency (see Settings).
+*  _startNote() is called by _startDueNotes(), '_ledLead' milliseconds early. A player may also have (optional):
+*      void _upcomingAdded(UpcomingNote* upcoming);   called when a note is put in _upcomingArray
+*
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> class Playback {
+  public:
+    /* NESTED CLASS: item-type of '_upcomingArray' : this represents a note to be played shortly  */
+    /* 6 bytes: an index instead of a pointer, and 16 bits times (see _getStartMillis), so more notes fit on the stack.
+    *  Kept as 1 struct (not 3 arrays): 3 x 16 bits has no padding, so separate arrays would not save a byte, and Player3's
+    *  _fallSchedule points to an entry of the CircularArray (3 arrays would need an index and 3 rings kept in step). */
+    class UpcomingNote {
+      public:
+        uint16_t noteIdx  : 11;  /* index of note in song (see MAX_NOTES), see _getNote() */
+        uint16_t midiDone : 1;   /* already sent to piano? ('_midiLead' early, see Settings::latencyMidi) */
+        uint16_t ledDone  : 1;   /* already started (_startNote)? ('_ledLead' early, see Settings::latencyLeds) */
+        uint16_t row      : 3;   /* free for the player (Player3: row of the LED panel while the note falls down) */
+        uint16_t startMillis;    /* when to start this note? lowest 16 bits of the time, see _getStartMillis() */
+        uint16_t durationMillis; /* how long to play this note? (at most 65 seconds) */
+    };
+    static_assert(MAX_NOTES <= (1 << 11), "UpcomingNote::noteIdx has 11 bits");
+    static_assert(GLOVE_COMMANDS_MAX < CAPACITY_NOTES_MAX, "CapacityPlanner must find an overflow of the glove commands");
+
+    Playback(MidiInterface* mi, Metronome* m, Gloves* g, MidiClock* c);
+    bool isSongFinished();
+    void setLoop(int startMeasureNr, int endMeasureNr);  /* A-B loop from the next start of the song, 0 = no loop */
+
+    bool isPlaying = false;
+    int curMeasureNr;        /* the current measure number while practicing (1=first) */
+
+  protected:
+    /* basic song info (copied from Song object) */
+    uint32_t  _resolution;         /* [resolution: ticks/quarter note] */
+    int       _totalTicks;         /* Total length of song in ticks. */
+    int       _noteCount;          /* how many of MAX_NOTES elements used? */
+    SongNote* _notes;              /* notes within song */
+
+    /* references to needed objects (NULL if not used by the policies) */
+    MidiInterface* _midi;
+    Metronome*     _metronome;
+    Gloves*        _gloves;
+    MidiClock*     _midiClock;
+
+    /* playing the song */
+    bool _doRepeat;              /* repeat after end of song (or loop)? */
+    bool _realtimeMode;          /* false while the song waits to start (external MIDI clock not yet followed) */
+    byte _midiPlay;              /* 0 = off, otherwise 1,2 or 3 (higher is louder) */
+    uint32_t _songEndMillis;     /* time (millis) when song is finished (only when _doRepeat = false) */
+    uint32_t _currentTick;       /* when was last note played (MIDI-ticks) ? */
+    uint32_t _lastMillis;        /* when was last note played (milli-seconds) ? */
+    uint32_t _playedTicks;       /* MIDI-ticks since start of playing (also counts repeats), needed to follow external MIDI clock */
+    uint32_t _clockOffsetMillis; /* when following external MIDI clock: how long was the song suspended (paused)? */
+    int _curNoteIdx;             /* index of next note (or measure) to schedule */
+    /* A-B loop: measures set by setLoop(), index/tick of loop start and loop end (without loop: start and end of song) */
+    int _loopStartMeasureNr;
+    int _loopEndMeasureNr;
+    int _loopStartIdx;
+    int _loopEndIdx;
+    uint32_t _loopStartTick;
+    uint32_t _loopEndTick;
+    uint32_t _timeAhead;         /* time (milliseconds) that note is put in _upcomingArr before it is actually played  */
+    uint32_t _missedMillis;
+    uint32_t _suspendMillis;     /* at what time was the song suspended (paused)? This is done using the foot pedal */
+    /* latency compensation: each output is done this many milliseconds early (see Settings) */
+    uint32_t _midiLead;
+    uint32_t _ledLead;
+    uint32_t _metronomeLead;
+    uint32_t _glovesLead;
+    /* tempo management */
+    unsigned int _tempo;           /* [tempo: ms/quarter note. Example: 461 means ~130 beats/min (= 60.000 / 461) ] */
+    uint16_t _tempoFactor;
+    uint16_t _tempoQPM;            /* tempo in quarter notes per minute */
+
+    CircularArray<UpcomingNote, (FLAGS & PLAYBACK_LOOK_AHEAD) ? UPCOMING_NOTES_MAX : 1> _upcomingArray; /* which notes are to played shortly? */
+    DelayManager<byte, UPCOMING_MEASURES_MAX>                                  _updateMeasureNrSchedule;  /* when should measure-nr be updated? */
+    DelayManager<byte, (FLAGS & PLAYBACK_GLOVES) ? GLOVE_COMMANDS_MAX : 1>      _glovesSchedule;           /* when should which finger of glove turn on/off? */
+
+    void _startTimeline(Song* song, int noteIdx, byte midiPlay, uint16_t tempoFactor, bool repeat, uint32_t startMillis);
+    bool _scheduleNext(uint32_t nowCorr);    /* next note or measure, if due within _timeAhead: true if one was handled */
+    void _startSustainedNotes(int sustainIdx, uint32_t nowCorr); /* after seek: notes that still sound (Song::getSustainStartIndex) */
+    void _addNote(int noteIdx, uint32_t playMillis, uint32_t durationMillis, uint32_t nowCorr);
+    bool _startDueNotes(uint32_t nowCorr);   /* PLAYBACK_LOOK_AHEAD: auto-play and _startNote() for upcoming notes that are due */
+    void _handleSchedules(uint32_t nowCorr, bool isPanelWriteDue = false); /* metronome, measure-nr, MIDI note-offs and gloves */
+    void _stopTimeline();
+    void _suspendTimeline();
+    uint32_t _resumeTimeline();              /* returns milliseconds that the song was suspended (timeline is shifted) */
+    bool _changeTempoFactor(uint16_t tempoFactor, uint32_t nowCorr);  /* while playing: false if timeline is not re-timed */
+    uint32_t _getMillisDuration(uint32_t ticks);
+    uint32_t _getPlayMillis(uint32_t dTicks);
+    void _setTempo(uint16_t qpm);
+    void _playMidiNote(UpcomingNote* upcoming);  /* send note to piano (auto-play) */
+    SongNote* _getNote(UpcomingNote* upcoming);
+    uint32_t _getStartMillis(UpcomingNote* upcoming);
+    void _upcomingAdded(UpcomingNote* upcoming) {}  /* default: player does nothing when a note is put in _upcomingArray */
+};
+
+
+/* Constructor: */
+template<class PLAYER, byte FLAGS> Playback<PLAYER, FLAGS>::Playback(MidiInterface* mi, Metronome* m, Gloves* g, MidiClock* c) {
+  _midi = mi;
+  _metronome = m;
+  _gloves = g;
+  _midiClock = c;
+  _loopStartMeasureNr = 0;
+  _loopEndMeasureNr = 0;
+}
+
+
+/* Loop measures 'startMeasureNr' up to and including 'endMeasureNr' (used from the next start of the song), 0 = no loop.
+*  The loop end is scheduled like the end of the song: the first notes of the next pass are scheduled ahead of time. */
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::setLoop(int startMeasureNr, int endMeasureNr) {
+  _loopStartMeasureNr = startMeasureNr;
+  _loopEndMeasureNr = endMeasureNr;
+}
+
+
+/* Copy song info and start the timeline at note/measure 'noteIdx': its tick is played at 'startMillis'. */
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_startTimeline(Song* song, int noteIdx, byte midiPlay, uint16_t tempoFactor, bool repeat, uint32_t startMillis) {
+  /* Copy some basic data/pointers from the song object, for performance reasons... */
+  _resolution = song->resolution;  /* ticks per quarter note */
+  _totalTicks = song->totalTicks;
+  _noteCount = song->noteCount;
+  _notes = song->notes;
+
+  /* loop bounds: the loop end is the start of the measure after the loop (the end of the song for the last measure) */
+  _loopStartIdx = 0;
+  _loopStartTick = 0;
+  _loopEndIdx = _noteCount;
+  _loopEndTick = _totalTicks;
+  if (_loopStartMeasureNr > 0) {
+    _loopStartIdx = song->getMeasureStartIndex(_loopStartMeasureNr);
+    _loopStartTick = _notes[_loopStartIdx].atTick;
+    if (_loopEndMeasureNr < song->lastMeasureNr) {
+      _loopEndIdx = song->getMeasureStartIndex(_loopEndMeasureNr + 1);
+      _loopEndTick = _notes[_loopEndIdx].atTick;
+    }
+  }
+
+  _doRepeat = repeat || (_loopStartMeasureNr > 0);  /* a loop always repeats */
+  _realtimeMode = true;
+  _midiPlay = midiPlay;         /* is auto-playing (MIDI) on? If so, what volume (very low, low, normal)? */
+  _songEndMillis = 0;
+  _curNoteIdx = noteIdx;
+  _currentTick = _notes[noteIdx].atTick;     /* start tick (is zero when starting at first measure) */
+
+  _tempoFactor = tempoFactor;   /* factor to change normal tempo (10% - 180%)  */
+  _tempoQPM = 0;  /* Tempo (in Quarter Notes per minute) is set later, when first measure is handled */
+  _tempo    = 0;  /* Tempo (in milliseconds per Quarter Note) is set later, when first measure is handled */
+
+  _timeAhead = 0;
+  _lastMillis = startMillis;
+  _missedMillis = 0;                        /* each time the LED-panel is updated, this will increase (compensate for disabled interrupts) */
+  _playedTicks = 0;
+  _clockOffsetMillis = 0;
+  bool isAhead = (FLAGS & PLAYBACK_LOOK_AHEAD);   /* without look-ahead, nothing can be done early */
+  _midiLead      = isAhead ? max(Settings::latencyMidi, 0) : 0;  /* LATENCY_AUTO: not (yet) measured */
+  _ledLead       = isAhead ? max(Settings::latencyLeds, 0) : 0;
+  _metronomeLead = isAhead ? (Settings::latencyMetronome == LATENCY_AUTO ? LATENCY_METRONOME_AUTO : max(Settings::latencyMetronome, 0)) : 0;
+  _glovesLead    = isAhead ? max(Settings::latencyGloves, 0) : 0;
+
+  _upcomingArray.reset();
+  _updateMeasureNrSchedule.reset();
+  _glovesSchedule.reset();
+  isPlaying = true;
+}
+
+
+/* Handle the next note or measure of the song if it is due (within '_timeAhead'), or the end of the song/loop. Call until
+*  false. The end is handled '_timeAhead' early too, so the notes after a repeat are scheduled without a gap. */
+template<class PLAYER, byte FLAGS> bool Playback<PLAYER, FLAGS>::_scheduleNext(uint32_t nowCorr) {
+  if ((FLAGS & PLAYBACK_MIDI_CLOCK) && _realtimeMode && _midiClock->mode == MIDI_CLOCK_SLAVE) {
+    if (!_midiClock->isFollowing()) return false; /* wait for clock 0 of the external MIDI clock (or after Stop) */
+    _tempo = _midiClock->getTempo();
+  }
+
+  uint32_t dTicks, dMillis;
+  if (_curNoteIdx >= _noteCount || _curNoteIdx == _loopEndIdx) { /* handle end of song (or loop) within this if */
+    uint32_t endTick = (_curNoteIdx == _loopEndIdx) ? _loopEndTick : _totalTicks; /* started after the loop: end of song */
+    dTicks = endTick - _currentTick;             /* MIDI-ticks between last note and the end ( >= 0 ) */
+    uint32_t endMillis = _getPlayMillis(dTicks); /* convert ticks to milliseconds  */
+    if ((nowCorr + _timeAhead) < endMillis) return false;
+    if (_doRepeat) {
+      _playedTicks += dTicks;
+      _currentTick = _loopStartTick;
+      _lastMillis = endMillis;
+      _curNoteIdx = _loopStartIdx;
+    }
+    else if (_songEndMillis == 0) {
+      _songEndMillis = endMillis + PLAYBACK_END_MILLIS;
+    }
+    return false;  /* 1 repeat per call at most */
+  }
+  SongNote* note = &_notes[_curNoteIdx];
+  SongMeasure* measure;
+  dTicks = note->atTick - _currentTick;  /* MIDI-ticks between former note and this new note ( >= 0 ) */
+  uint32_t playMillis = _getPlayMillis(dTicks); /* convert ticks to milliseconds */
+
+  if ((nowCorr + _timeAhead) < playMillis) return false;
+
+  switch(note->type) {
+    case TYPE_MEASURE:
+    case TYPE_MEASURE_BM:
+      /* it's a measure: set tempo (might be changed) and plan the metronome beats */
+      measure = (SongMeasure*)note;
+      if (FLAGS & PLAYBACK_LOOK_AHEAD) _updateMeasureNrSchedule.add(measure->measureNr, playMillis); /* set measure-nr later, when measure really starts */
+      else curMeasureNr = measure->measureNr;
+      _setTempo(measure->tempoQPM);
+      if (FLAGS & PLAYBACK_MIDI_CLOCK) _midiClock->newMeasure(playMillis, _tempo);  /* MIDI clock master: clocks are aligned with start of measure */
+      if (FLAGS & PLAYBACK_METRONOME) {
+        dMillis = _getMillisDuration(measure->beatTicks); /* calc duration of 1 metronome beat */
+        _metronome->startNewMeasure(measure->beatCount, dMillis, (FLAGS & PLAYBACK_LOOK_AHEAD) ? playMillis - _metronomeLead : nowCorr + PLAYBACK_METRONOME_DELAY);
+      }
+      break;
+    case TYPE_NOTE:
+      _addNote(_curNoteIdx, playMillis, _getMillisDuration(note->duration), nowCorr);
+      break;
+  }
+  _playedTicks += dTicks;
+  _currentTick = note->atTick;
+  _lastMillis = playMillis;
+  _curNoteIdx++;
+  return true;
+}
+
+
+/* Note is due (within '_timeAhead'): into _upcomingArray, or started now (no look-ahead). Gloves are scheduled. */
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_addNote(int noteIdx, uint32_t playMillis, uint32_t durationMillis, uint32_t nowCorr) {
+  SongNote* note = &_notes[noteIdx];
+  if (FLAGS & PLAYBACK_LOOK_AHEAD) {
+    /* add to _upcomingArray along with some extra data like play-time and duration in milliseconds */
+    UpcomingNote* upcoming = _upcomingArray.add();
+    upcoming->noteIdx = noteIdx;
+    upcoming->startMillis = playMillis;                  /* lowest 16 bits */
+    upcoming->durationMillis = min(durationMillis, (uint32_t)0xFFFF);
+    upcoming->midiDone = (_midiPlay == PLAY_WHILE_PRACTICE_OFF); /* nothing to send when auto-play is off */
+    upcoming->ledDone = false;
+    static_cast<PLAYER*>(this)->_upcomingAdded(upcoming);
+  }
+  else {
+    static_cast<PLAYER*>(this)->_startNote(note, durationMillis, nowCorr);
+  }
+  if (FLAGS & PLAYBACK_GLOVES) {
+    /* Schedule when to turn on / off glove finger vibrating motor */
+    uint32_t gloveMillis = playMillis - _glovesLead; /* glove motors will be turned on a little more earlier */
+    _glovesSchedule.add(note->finger + GLOVE_FINGER_ON, gloveMillis); /* schedule to turn ON glove-finger */
+    _glovesSchedule.add(note->finger + GLOVE_FINGER_OFF, gloveMillis + durationMillis - 5); /* schedule to turn OFF glove-finger */
+  }
+}
+
+
+/* Started at a measure (or a note) that is not the start of the song: notes before it that still sound at its tick are
+*  played from the start of the timeline, with the rest of their duration (as if the song was played from the start).
+*  Call after _startTimeline (and after the player has moved to its first note, if it does). Not constant time: the notes
+*  between the checkpoint's 'sustainIdx' and the start are scanned (see SongCheckpoint), once per start. */
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_startSustainedNotes(int sustainIdx, uint32_t nowCorr) {
+  SongMeasure* measure = (SongMeasure*)&_notes[_curNoteIdx];
+  if (_tempo == 0 && measure->type != TYPE_NOTE) _setTempo(measure->tempoQPM);  /* tempo in force at the measure */
+  for (int i = sustainIdx; i < _curNoteIdx; i++) {
+    SongNote* note = &_notes[i];
+    if (note->type != TYPE_NOTE) continue;
+    uint32_t endTick = note->atTick + note->duration;
+    if (endTick <= _currentTick) continue;  /* note has ended already */
+    _addNote(i, _lastMillis, _getMillisDuration(endTick - _currentTick), nowCorr);
+  }
+}
+
+
+/* PLAYBACK_LOOK_AHEAD: send upcoming notes to the piano '_midiLead' ms early, start them (_startNote) '_ledLead' ms early.
+*  Each by its own lead: a note stays in _upcomingArray until both are done (e.g. LED started, MIDI not yet due). */
+template<class PLAYER, byte FLAGS> bool Playback<PLAYER, FLAGS>::_startDueNotes(uint32_t nowCorr) {
+  bool isStarted = false;
+  UpcomingNote* upcoming;
+  _upcomingArray.iterateInit(true);
+  while ( (upcoming = _upcomingArray.iterate()) != NULL) {
+    uint32_t startMillis = _getStartMillis(upcoming);
+    bool isMidiDue = (startMillis <= nowCorr + _midiLead);
+    bool isLedDue = (startMillis <= nowCorr + _ledLead);
+    if (!isMidiDue && !isLedDue) break;  /* not yet time for this note and all thereafter... */
+    /* always true: note->type == TYPE_NOTE */
+    if (isMidiDue && !upcoming->midiDone) _playMidiNote(upcoming);
+    if (isLedDue && !upcoming->ledDone) {
+      static_cast<PLAYER*>(this)->_startNote(_getNote(upcoming), upcoming->durationMillis, nowCorr);
+      upcoming->ledDone = true;
+      isStarted = true;
+    }
+  }
+  /* first notes in circular array are handled (not upcoming anymore), so remove them */
+  while ( (upcoming = _upcomingArray.getFirst()) != NULL && upcoming->midiDone && upcoming->ledDone) {
+    _upcomingArray.removeFirst();
+  }
+  return isStarted;
+}
+
+
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_handleSchedules(uint32_t nowCorr, bool isPanelWriteDue) {
+  byte* mNr;     /* measure number */
+  byte* finger;  /* finger-nr for gloves */
+  if (FLAGS & PLAYBACK_METRONOME) _metronome->handleBeats(nowCorr, isPanelWriteDue);  /* player writes the LED panel next? */
+  while ( (mNr = _updateMeasureNrSchedule.checkForRelease(nowCorr)) != NULL) {
+    curMeasureNr = *mNr; /* update measure-nr, because new measure starts now...  */
+  }
+  _midi->handleDelays(nowCorr);
+  if (FLAGS & PLAYBACK_GLOVES) {
+    /* is it time to turn on/off glove-fingers (vibrating motors)? */
+    while ( (finger = _glovesSchedule.checkForRelease(nowCorr)) != NULL) {
+      bool on = (*finger & GLOVE_FINGER_ON);
+      _gloves->setFinger(*finger & 0b1111 /* remove flags */, on);
+    }
+    _gloves->updateGloves(); /* If finger-data changed, update status of vibrating motors in gloves. */
+  }
+}
+
+
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_stopTimeline() {
+  isPlaying = false;
+  if (FLAGS & PLAYBACK_METRONOME) _metronome->reset();
+  if (FLAGS & PLAYBACK_MIDI_CLOCK) _midiClock->stopSong();
+  _midi->handleAllDelaysImmediately();
+  if (FLAGS & PLAYBACK_GLOVES) _gloves->reset(false);
+  _upcomingArray.reset();
+}
+
+
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_suspendTimeline() {
+  _suspendMillis = millis();
+  if (FLAGS & PLAYBACK_MIDI_CLOCK) _midiClock->suspend();
+}
+
+
+template<class PLAYER, byte FLAGS> uint32_t Playback<PLAYER, FLAGS>::_resumeTimeline() {
+  uint32_t dMillis = millis() - _suspendMillis; /* how long was the song suspended/paused? */
+  dMillis += 100;      /* 100ms extra  */
+  _lastMillis += dMillis;
+  _clockOffsetMillis += dMillis;   /* external MIDI clock: song continues where it was paused, so later than the clock */
+  if (FLAGS & PLAYBACK_MIDI_CLOCK) _midiClock->resume(dMillis);
+  if (_songEndMillis != 0) _songEndMillis += dMillis;
+  _updateMeasureNrSchedule.addSuspendedMillis(dMillis);
+  _glovesSchedule.addSuspendedMillis(dMillis);
+  UpcomingNote* upcoming;
+  _upcomingArray.iterateInit(true);
+  while( (upcoming = _upcomingArray.iterate() ) != NULL) {
+    upcoming->startMillis += dMillis;  /* lowest 16 bits: same as adding to the time */
+  }
+  return dMillis;
+}
+
+
+/******************************************************************************************************************************
+* The tempo factor changes while playing. Everything that is scheduled after 'nowCorr' is re-timed around 'nowCorr' (its
+* distance to 'nowCorr' is multiplied by old/new factor, see scaleMillis): the timeline, upcoming notes (time and
+* duration), measure-nrs, gloves, metronome beats, MIDI note-offs and MIDI clock. So nothing is dropped or played twice, and
+* the song continues where it is. The player re-times its own schedules the same way (only if true is returned).
+* When following an external MIDI clock, the tempo is set by the clock: only the factor is kept (used after the clock stops).
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> bool Playback<PLAYER, FLAGS>::_changeTempoFactor(uint16_t tempoFactor, uint32_t nowCorr) {
+  if (tempoFactor == _tempoFactor) return false;
+  uint32_t mul = _tempoFactor;  /* milliseconds per quarter note are inversely proportional to the tempo factor */
+  uint32_t div = tempoFactor;
+  _tempoFactor = tempoFactor;
+  if ((FLAGS & PLAYBACK_MIDI_CLOCK) && _midiClock->isFollowing()) return false;
+  if (_tempoQPM != 0) _tempo = 6000000 / (_tempoQPM * _tempoFactor);  /* see _setTempo */
+
+  UpcomingNote* upcoming;
+  _upcomingArray.iterateInit(true);
+  while( (upcoming = _upcomingArray.iterate() ) != NULL) {  /* before _lastMillis changes, see _getStartMillis */
+    upcoming->startMillis = scaleMillis(_getStartMillis(upcoming), nowCorr, mul, div);  /* lowest 16 bits */
+    upcoming->durationMillis = min(upcoming->durationMillis * mul / div, (uint32_t)0xFFFF);
+  }
+  if (_lastMillis < nowCorr) _lastMillis = nowCorr - (nowCorr - _lastMillis) * mul / div;  /* ticks since then passed at the old tempo */
+  else _lastMillis = scaleMillis(_lastMillis, nowCorr, mul, div);
+  if (_songEndMillis != 0) _songEndMillis = scaleMillis(_songEndMillis, nowCorr, mul, div);
+  _updateMeasureNrSchedule.scaleDelays(nowCorr, mul, div);
+  if (FLAGS & PLAYBACK_GLOVES) _glovesSchedule.scaleDelays(nowCorr, mul, div);
+  if (FLAGS & PLAYBACK_METRONOME) _metronome->scaleBeats(nowCorr, mul, div);
+  if (FLAGS & PLAYBACK_MIDI_CLOCK) _midiClock->scaleTempo(nowCorr, mul, div);
+  _midi->scaleDelays(nowCorr, mul, div);
+  return true;
+}
+
+
+/******************************************************************************************************************************
+* Auto-play: send note to piano. Note-off is scheduled in MidiInterface.
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_playMidiNote(UpcomingNote* upcoming) {
+  SongNote* note = _getNote(upcoming);
+  uint32_t d = upcoming->durationMillis;
+  byte velocity; /* MIDI-velocity/volume of note */
+  /* the note must be played via MIDI, there are 3 possible degrees for velocity/volume */
+  velocity = note->velocity >> 3;  /*  1/8  of velocity */
+  if      (_midiPlay == PLAY_WHILE_PRACTICE_VOLU_1) velocity = (note->velocity>>2) + velocity; /* 1/4 + 1/8 = 37% */
+  else if (_midiPlay == PLAY_WHILE_PRACTICE_VOLU_2) velocity = (note->velocity>>1) + velocity; /* 1/2 + 1/8 = 62% */
+  else                                              velocity = note->velocity;                 /* 100% velocity  */
+  _midi->playNote(note->pitch, velocity, _getStartMillis(upcoming) + d - (d/10) - _midiLead);
+  upcoming->midiDone = true;
+}
+
+
+template<class PLAYER, byte FLAGS> SongNote* Playback<PLAYER, FLAGS>::_getNote(UpcomingNote* upcoming) {
+  return &_notes[upcoming->noteIdx];
+}
+
+
+/* Upcoming notes start at most a few seconds before '_lastMillis' (the last note or measure that was scheduled), so the
+*  full time is found from its lowest 16 bits (difference with '_lastMillis' between -32 and +32 seconds). */
+template<class PLAYER, byte FLAGS> uint32_t Playback<PLAYER, FLAGS>::_getStartMillis(UpcomingNote* upcoming) {
+  return _lastMillis + (int16_t)(upcoming->startMillis - (uint16_t)_lastMillis);
+}
+
+
+/******************************************************************************************************************************
+* Tempo is set when first measure is handled and also when tempo must change (possible per measure, not per note!)
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> void Playback<PLAYER, FLAGS>::_setTempo(uint16_t qpm) {
+  if ((FLAGS & PLAYBACK_MIDI_CLOCK) && qpm != 0) _midiClock->setNominalTempo(6000000 / (qpm * _tempoFactor)); /* until clock 1 */
+  if ((FLAGS & PLAYBACK_MIDI_CLOCK) && _midiClock->isFollowing()) { _tempo = _midiClock->getTempo(); return; } /* tempo is set by external MIDI clock */
+  if (qpm == _tempoQPM) return; /* tempo not changed: do nothing */
+  _tempoQPM = qpm;  /* in Quarter Notes per minute */
+  _tempo = 6000000 / (_tempoQPM * _tempoFactor); /* in Milliseconds per Quarter Note */
+}
+
+/******************************************************************************************************************************
+* Convert duration from MIDI-ticks to Milliseconds  :    ticks * (ms/QN) / (ticks/QN) = ms
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> uint32_t Playback<PLAYER, FLAGS>::_getMillisDuration(uint32_t ticks) {
+  return ((uint32_t)ticks * _tempo / _resolution);
+}
+
+/******************************************************************************************************************************
+* When to play a note that is 'dTicks' after the last note? When following an external MIDI clock, this is the (predicted)
+* time of the corresponding clock. Otherwise the duration is added to the time of the last note.
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> uint32_t Playback<PLAYER, FLAGS>::_getPlayMillis(uint32_t dTicks) {
+  if ((FLAGS & PLAYBACK_MIDI_CLOCK) && _midiClock->isFollowing()) {
+    return _midiClock->getMillisAtTick(_playedTicks + dTicks, _resolution) + _clockOffsetMillis;
+  }
+  return _lastMillis + _getMillisDuration(dTicks);
+}
+
+
+/******************************************************************************************************************************
+* Only return true if the song is finished. When repeat is ON, then always return false.
+*******************************************************************************************************************************/
+template<class PLAYER, byte FLAGS> bool Playback<PLAYER, FLAGS>::isSongFinished() {
+  /* _songEndMillis is set when the end of the song is scheduled, only when repeat-mode is OFF. */
+  if (_songEndMillis == 0) return false;
+  uint32_t nowCorr = millis() + _missedMillis;
+  return (_songEndMillis < nowCorr );
+}
+
+
+
+#endif // Playback_h
@@ -0,0 +1,183 @@
+#include "Recorder.h"
+
+
+
+/* Header of Standard MIDI File (format 0, 1 track, REC_TICKS_PER_QN), followed by track header with (yet) unknown length */
+static const byte _smfHeader[] PROGMEM = {
+  'M', 'T', 'h', 'd',  0, 0, 0, 6,  0, 0,  0, 1,  (REC_TICKS_PER_QN >> 8), (REC_TICKS_PER_QN & 0xFF),
+  'M', 'T', 'r', 'k',  0, 0, 0, 0
+};
+#define REC_TRACK_LENGTH_POS 18     /* position of track length in _smfHeader (written when recording stops) */
+
+/* First event of track: set tempo to 120 BPM (500000 microseconds per quarter note) */
+static const byte _smfTempo[] PROGMEM = { 0x00, 0xFF, 0x51, 0x03, 0x07, 0xA1, 0x20 };
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  Recorder
+*
+*******************************************************************************************************************************
+* Some details:
+* - Time is 'millis()' corrected with the time missed while the LED panel was written (interrupts disabled), so long
+*   recordings do not run too fast.
+* - The SMF header is also put in the ring, so every write to the SD card is exactly 1 sector at a sector boundary of the file
+*   (no read-modify-write by the SD library). Only the last write (when recording stops) can be smaller.
+* - When the ring is full, events are dropped (counted), but delta-times of later events stay correct.
+*******************************************************************************************************************************/
+
+
+Recorder::Recorder(LedPanel* lp) {
+  _ledPanel = lp;
+  isRecording = false;
+  droppedEvents = 0;
+  _lastFileNr = REC_NR_UNKNOWN;
+}
+
+
+/******************************************************************************************************************************
+* Start recording to the file name after the last recording (REC001.MID, REC002.MID, ...). Returns false if no file could be
+* created. The SD card is scanned once (1 pass over the directory, the first time), thereafter the number counts up, so
+* starting takes about 1 SD.exists() (each call walks the directory), not 1 per recording on the card.
+*******************************************************************************************************************************/
+bool Recorder::startRecording() {
+  if (isRecording) return true;
+  if (_lastFileNr == REC_NR_UNKNOWN) _scanLastFileNr();
+  int nr;
+  for (nr = _lastFileNr + 1; nr <= REC_MAX_FILES; nr++) {
+    sprintf(_filename, "REC%03d.MID", nr);
+    if (!SD.exists(_filename)) break;     /* exists: e.g. copied to the card after the scan */
+  }
+  if (nr > REC_MAX_FILES) return false;
+  _file = SD.open(_filename, FILE_WRITE);
+  if (!_file) return false;
+  _lastFileNr = nr;
+
+  _bufferWrite = _bufferRead = _bufferCount = 0;
+  _status = 0;
+  _dataCount = 0;
+  droppedEvents = 0;
+  for (unsigned int i = 0; i < sizeof(_smfHeader); i++) _putByte(_smfHeader[i]);
+  for (unsigned int i = 0; i < sizeof(_smfTempo); i++) _putByte(_smfTempo[i]);
+  _trackBytes = sizeof(_smfTempo);
+  _lastEventMillis = millis() + _ledPanel->missedMillis;
+  isRecording = true;
+  return true;
+}
+
+
+/* Highest number of the REC<nr>.MID files on the SD card (0 if none), see SdCard::scanUserAndSongFiles */
+void Recorder::_scanLastFileNr() {
+  _lastFileNr = 0;
+  File root = SD.open("/");
+  root.rewindDirectory();
+  File entry = root.openNextFile();
+  while (entry) {
+    char* name = entry.name();
+    if (!entry.isDirectory() && strncmp(name, "REC", 3) == 0 && isdigit(name[3])) {
+      int nr = atoi(name + 3);
+      if (nr > _lastFileNr && nr <= REC_MAX_FILES) _lastFileNr = nr;
+    }
+    entry.close();
+    entry = root.openNextFile();
+  }
+  root.close();
+}
+
+
+/******************************************************************************************************************************
+* Parse byte received from piano. Channel messages (note on/off, sustain pedal, etc.) are recorded with their velocity
+* and time of arrival. Running status is supported. Real-time, system common and SysEx messages are ignored.
+*******************************************************************************************************************************/
+void Recorder::receiveByte(byte b) {
+  if (!isRecording) return;
+  if (b >= MidiType::Clock) return;                                     /* real-time message: not recorded */
+  if (b >= MidiType::SystemExclusive) { _status = 0; return; }          /* system message: not recorded, no running status */
+  if (b & 0x80) { _status = b; _dataCount = 0; return; }                /* status byte of channel message */
+  if (_status == 0) return;                                             /* data byte of message that is not recorded */
+  _data[_dataCount++] = b;
+  byte type = _status & 0xF0;
+  byte needed = (type == MidiType::ProgramChange || type == MidiType::AfterTouchChannel) ? 1 : 2;
+  if (_dataCount < needed) return;
+  _addEvent(_status, _data[0], _data[1], needed);
+  _dataCount = 0;                                                       /* running status: next data byte starts new message */
+}
+
+
+/******************************************************************************************************************************
+* Called in idle time of the practice loops: write 1 sector to SD card, when available.
+*******************************************************************************************************************************/
+void Recorder::handleWriting() {
+  if (!isRecording) return;
+  if (_bufferCount >= REC_SECTOR_SIZE) _writeSector(REC_SECTOR_SIZE);
+}
+
+
+/******************************************************************************************************************************
+* Write 'End of track' and remaining data, then write the track length in the track header.
+*******************************************************************************************************************************/
+void Recorder::stopRecording() {
+  if (!isRecording) return;
+  isRecording = false;
+  if (_bufferCount > REC_BUFFER_SIZE - 4) _writeSector(REC_SECTOR_SIZE);
+  _putByte(0x00); _putByte(0xFF); _putByte(0x2F); _putByte(0x00);     /* meta event: End of track */
+  _trackBytes += 4;
+  while (_bufferCount > 0) {
+    _writeSector(min(_bufferCount, REC_SECTOR_SIZE));
+  }
+  _file.close();
+
+  File file = SD.open(_filename, O_RDWR);   /* not FILE_WRITE: that would always append at end of file */
+  if (!file) return;
+  byte length[4] = { (byte)(_trackBytes >> 24), (byte)(_trackBytes >> 16), (byte)(_trackBytes >> 8), (byte)_trackBytes };
+  file.seek(REC_TRACK_LENGTH_POS);
+  file.write(length, 4);
+  file.close();
+}
+
+
+void Recorder::_putByte(byte b) {
+  _buffer[_bufferWrite] = b;
+  _bufferWrite = (_bufferWrite + 1) % REC_BUFFER_SIZE;
+  _bufferCount++;
+}
+
+
+/* Write delta-time as variable length quantity (7 bits per byte, most significant first, bit-7 set for all but the last) */
+void Recorder::_putDeltaTime(uint32_t dTicks) {
+  byte bytes[4];
+  byte n = 0;
+  if (dTicks > 0x0FFFFFFF) dTicks = 0x0FFFFFFF;   /* max for 4 bytes (more than 74 hours) */
+  do {
+    bytes[n++] = dTicks & 0x7F;
+    dTicks >>= 7;
+  } while (dTicks > 0);
+  while (--n > 0) _putByte(bytes[n] | 0x80);
+  _putByte(bytes[0]);
+}
+
+
+void Recorder::_addEvent(byte status, byte data1, byte data2, byte dataCount) {
+  if (REC_BUFFER_SIZE - _bufferCount < REC_MAX_EVENT_SIZE) {
+    droppedEvents++;  /* no room in ring: SD card could not keep up */
+    return;
+  }
+  uint32_t now = millis() + _ledPanel->missedMillis;
+  uint16_t countBefore = _bufferCount;
+  _putDeltaTime(now - _lastEventMillis);  /* 1 tick = 1 ms */
+  _lastEventMillis = now;
+  _putByte(status);
+  _putByte(data1);
+  if (dataCount == 2) _putByte(data2);
+  _trackBytes += _bufferCount - countBefore;
+}
+
+
+/* Write 'count' bytes (1 sector, or less for the last write) from the ring to the SD card */
+bool Recorder::_writeSector(uint16_t count) {
+  size_t written = _file.write(&_buffer[_bufferRead], count);
+  _bufferRead = (_bufferRead + count) % REC_BUFFER_SIZE;
+  _bufferCount -= count;
+  return (written == count);
+}
@@ -0,0 +1,66 @@
+#ifndef Recorder_h
+#define Recorder_h
+
+#include <Arduino.h>
+#include <SD.h>
+#include "MidiDefs.h"
+#include "LedPanel.h"
+
+#define REC_SECTOR_SIZE      512                     /* bytes written to SD card at once (1 SD card block) */
+#define REC_BUFFER_SIZE      (2 * REC_SECTOR_SIZE)   /* RAM ring: while 1 sector is written, the other can still be filled */
+#define REC_MAX_EVENT_SIZE   8                       /* max bytes of 1 event in file: delta-time (max 4) + MIDI message (max 3) */
+#define REC_TICKS_PER_QN     500                     /* with default tempo 120 BPM (500000 us per quarter note): 1 tick = 1 ms */
+#define REC_MAX_FILES        999                     /* recordings are saved as REC001.MID ... REC999.MID */
+#define REC_NR_UNKNOWN       0xFFFF                  /* SD card not scanned yet for the last recording */
+
+/******************************************************************************************************************************
+*
+* CLASS  :  Recorder
+*
+* Records what the user plays on the piano (MIDI messages with velocity and timing) to a Standard MIDI File (format 0).
+* MidiInterface passes every received byte (receiveByte). Complete messages are coded to the SMF format immediately and
+* stored in a RAM ring. The ring is written to the SD card in complete sectors, only when handleWriting() is called,
+* which is done in idle time of the practice loops (never inside handlePlaying() of a Player).
+*
+*******************************************************************************************************************************/
+class Recorder {
+  public:
+    /**
+    * Constructor.
+    */
+    Recorder(LedPanel* lp);
+    bool startRecording();                /* open new file REC<nr>.MID */
+    void receiveByte(byte b);             /* called by MidiInterface for every byte received from piano */
+    void handleWriting();                 /* idle time: write 1 sector to SD card (if available) */
+    void stopRecording();                 /* write remaining data and close file */
+
+    bool isRecording;
+    uint16_t droppedEvents;               /* events that did not fit in the RAM ring (SD card too slow) */
+
+  private:
+    LedPanel* _ledPanel;
+    File _file;
+    char _filename[12];
+    uint16_t _lastFileNr;                 /* number of the last recording on the SD card (REC_NR_UNKNOWN: not scanned yet) */
+    byte _buffer[REC_BUFFER_SIZE];        /* RAM ring with SMF data, not yet written to SD card */
+    uint16_t _bufferWrite;                /* index where next byte is put in _buffer */
+    uint16_t _bufferRead;                 /* index of first byte not yet written to SD card (always at start of sector) */
+    uint16_t _bufferCount;                /* number of bytes in _buffer */
+    uint32_t _trackBytes;                 /* length of track data (for MTrk header) */
+    uint32_t _lastEventMillis;            /* time of last event (delta-times are relative to this) */
+    /* parser of incoming bytes */
+    byte _status;                         /* running status */
+    byte _data[2];
+    byte _dataCount;                      /* received data bytes */
+
+    void _putByte(byte b);
+    void _putDeltaTime(uint32_t dTicks);
+    void _addEvent(byte status, byte data1, byte data2, byte dataCount);
+    bool _writeSector(uint16_t count);
+    void _scanLastFileNr();
+};
+
+
+
+
+#endif // Recorder_h
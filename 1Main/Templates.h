@@ -4,6 +4,7 @@
 #define Templates_h
 
 #include <Arduino.h>
+#include <new>          /* placement new (SharedRegion) */
 
 
 
@@ -150,6 +151,13 @@ template<typename T, byte SIZE> void CircularArray<T, SIZE>::dump() {
 *  The DelayManager can be polled (with current time provided), to get data elements at the right time.
 *******************************************************************************************************************************/
 
+/* Tempo change at 'now': a time after 'now' moves so that its distance to 'now' is multiplied by mul/div (e.g. old/new tempo
+*  factor). A time that is due is not changed. */
+inline uint32_t scaleMillis(uint32_t t, uint32_t now, uint32_t mul, uint32_t div) {
+  if (t <= now) return t;
+  return now + (t - now) * mul / div;
+}
+
 template<typename T, int SIZE> class DelayManager {
   public:
     /**
@@ -163,6 +171,7 @@ template<typename T, int SIZE> class DelayManager {
     void removeFirst();
     void reset();
     void addSuspendedMillis(uint32_t dMillis);
+    void scaleDelays(uint32_t now, uint32_t mul, uint32_t div);  /* tempo change: see scaleMillis() */
 #ifdef DEBUG_MODE
     void dump();                            /* for testing only */
 #endif // DEBUG_MODE
@@ -170,7 +179,6 @@ template<typename T, int SIZE> class DelayManager {
   private:
     T items[SIZE];                 /* buffer, sorted and works in circular way */
     uint32_t times[SIZE];     /* buffer, sorted and works in circular way */
-    void sort();
     int idx1, idx2;
 };
 
@@ -182,35 +190,19 @@ template<typename T, int SIZE> DelayManager<T, SIZE>::DelayManager() {
   idx2 = 0;     /* index of new item to be added */
 }
 
-/* Add item and sort so that first item is to be released first */
+/* Add item at its place, so that first item is to be released first (items are always sorted) */
 template<typename T, int SIZE> void DelayManager<T, SIZE>::add(T item, long wakeTime) {
-  items[idx2] = item;
-  times[idx2] = wakeTime;
+  int i = idx2;
   idx2 = (idx2 + 1) % SIZE;
-  sort();
-}
-
-/* Sort items, first item is to be released first */
-template<typename T, int SIZE> void DelayManager<T, SIZE>::sort() {
-  bool swapped;
-  do {
-    swapped = false;
-    int j = idx1;
-    for (int i = idx1; i != idx2; i = (i + 1) % SIZE) {
-      if (i == idx1) continue;  /* wait for 2nd item to compare to */
-      /* bubble sort: compare items j and i and swap if wakeTime of j is higher. */
-      if (times[j] > times[i]) {
-        T item = items[j];              /* swap data part */
-        items[j] = items[i];
-        items[i] = item;
-        uint32_t tmp = times[j];   /* swap time part */
-        times[j] = times[i];
-        times[i] = tmp;
-        swapped = true;
-      }
-      j = i;
-    }
-  } while (swapped);
+  while (i != idx1) {
+    int j = (i == 0) ? SIZE - 1 : i - 1;
+    if (times[j] <= (uint32_t)wakeTime) break;  /* items with the same wakeTime stay in order of adding */
+    items[i] = items[j];                         /* item j is released later: move it 1 place up */
+    times[i] = times[j];
+    i = j;
+  }
+  items[i] = item;
+  times[i] = wakeTime;
 }
 
 
@@ -262,6 +254,13 @@ template<typename T, int SIZE> void DelayManager<T, SIZE>::addSuspendedMillis(ui
   } while (i != idx2);  
 }
 
+/* Items after 'now' are released earlier or later (the order stays the same), items that are due are not changed */
+template<typename T, int SIZE> void DelayManager<T, SIZE>::scaleDelays(uint32_t now, uint32_t mul, uint32_t div) {
+  for (int i = idx1; i != idx2; i = (i + 1) % SIZE) {
+    times[i] = scaleMillis(times[i], now, mul, div);
+  }
+}
+
 #ifdef DEBUG_MODE
 
 template<typename T, int SIZE> void DelayManager<T, SIZE>::dump() {
@@ -281,4 +280,43 @@ template<typename T, int SIZE> void DelayManager<T, SIZE>::dump() {
 #endif // DEBUG_MODE
 
 
+
+/******************************************************************************************************************************
+*
+*  TEMPLATE  :  SharedRegion
+*
+*  Statically reserved memory for 1 object at a time, of one of the types T... (e.g. the player of the current mode).
+*  The size is that of the largest type, known at compile time, so the RAM it uses is reserved at link time (the linker
+*  reports when RAM is too small) instead of being taken from the stack.
+*  create<P>(constructor arguments) constructs a P in the region: the object that was there before is gone (only types
+*  without destructor are allowed, so nothing needs to be cleaned up).
+*******************************************************************************************************************************/
+
+constexpr size_t sharedRegionMax(size_t a) { return a; }
+template<typename... R> constexpr size_t sharedRegionMax(size_t a, size_t b, R... rest) {
+  return sharedRegionMax(a > b ? a : b, rest...);
+}
+
+template<typename A, typename B> struct SharedRegionSame { static constexpr bool value = false; };
+template<typename A> struct SharedRegionSame<A, A> { static constexpr bool value = true; };
+template<typename P> constexpr bool sharedRegionHas() { return false; }
+template<typename P, typename T1, typename... R> constexpr bool sharedRegionHas() {
+  return SharedRegionSame<P, T1>::value || sharedRegionHas<P, R...>();
+}
+
+template<typename... T> class SharedRegion {
+  public:
+    static constexpr size_t SIZE = sharedRegionMax(sizeof(T)...);
+
+    template<typename P, typename... A> P& create(A... args) {
+      static_assert(sharedRegionHas<P, T...>(), "type is not one of the types of this SharedRegion");
+      static_assert(__has_trivial_destructor(P), "objects in a SharedRegion are never destructed");
+      return *new (_buffer) P(args...);
+    }
+
+  private:
+    alignas(T...) byte _buffer[SIZE];
+};
+
+
 #endif // Templates_h
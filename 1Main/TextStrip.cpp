@@ -0,0 +1,79 @@
+#include "TextStrip.h"
+
+
+
+/******************************************************************************************************************************
+*
+* CLASS  :  TextStrip
+*
+*******************************************************************************************************************************/
+
+
+TextStrip::TextStrip() {
+  clear();
+}
+
+
+void TextStrip::clear() {
+  width = 0;
+  _runCount = 0;
+}
+
+
+/******************************************************************************************************************************
+* Render text with the glyph cache of the LED panel (2 columns between characters, like LedPanel::writeText). Columns that
+* do not fit in the strip are dropped. Each text starts a run with its color (no more runs: the text gets the color of the
+* last run).
+*******************************************************************************************************************************/
+int TextStrip::addText(LedPanel* lp, const char* txt, byte clr) {
+  if (_runCount < TEXT_STRIP_MAX_RUNS) {
+    _runStarts[_runCount] = width;
+    _runColors[_runCount++] = clr;
+  }
+  int widthBefore = width;
+  for (int tIdx = 0; txt[tIdx] != 0; tIdx++) {
+    if (tIdx > 0) addSpace(2);
+    const byte* glyph = lp->getGlyph(txt[tIdx]);
+    int w = lp->getCharWidth(txt[tIdx]);
+    for (int i = 0; i < w; i++) _addColumn(glyph[i]);
+  }
+  return width - widthBefore;
+}
+
+
+void TextStrip::addSpace(int columns) {
+  for (int i = 0; i < columns; i++) _addColumn(0);   /* part of the run before (color does not matter) */
+}
+
+
+/******************************************************************************************************************************
+* Copy the columns that are visible to the LED panel. Columns left of x are not changed.
+*******************************************************************************************************************************/
+void TextStrip::draw(LedPanel* lp, int x) {
+  if (width == 0) return;
+  int i = (x >= 0) ? 0 : (-x) % width;              /* column of strip at the first visible column of the LED panel */
+  int run = -1;                                     /* run of column i (-1: columns before the first text) */
+  for (int px = max(0, x); px < PANEL_COLS; px++) {
+    while (run + 1 < _runCount && _runStarts[run + 1] <= i) run++;
+    byte clr = (run >= 0) ? _runColors[run] : COLOR_IDX_OFF;
+    lp->writeColumn(px, _getColumn(i), clr, false);
+    if (++i == width) { i = 0; run = -1; }          /* strip repeats itself */
+  }
+}
+
+
+void TextStrip::_addColumn(byte bits) {
+  if (width >= TEXT_STRIP_MAX_COLUMNS) return;
+  uint16_t bitIdx = width * TEXT_STRIP_COLUMN_BITS;
+  uint16_t pair = (_columns[bitIdx / 8] | (_columns[bitIdx / 8 + 1] << 8)) & ~(TEXT_STRIP_PIXELS << (bitIdx % 8));
+  pair |= (bits & TEXT_STRIP_PIXELS) << (bitIdx % 8);
+  _columns[bitIdx / 8] = pair & 0xFF;
+  _columns[bitIdx / 8 + 1] = pair >> 8;
+  width++;
+}
+
+
+byte TextStrip::_getColumn(int i) {
+  uint16_t bitIdx = i * TEXT_STRIP_COLUMN_BITS;
+  return ((_columns[bitIdx / 8] | (_columns[bitIdx / 8 + 1] << 8)) >> (bitIdx % 8)) & TEXT_STRIP_PIXELS;
+}
@@ -0,0 +1,48 @@
+#ifndef TextStrip_h
+#define TextStrip_h
+
+#include <Arduino.h>
+#include "LedPanel.h"
+
+#define TEXT_STRIP_MAX_COLUMNS  840   /* user name (14) + song id (3) + song name (99 characters): max 5 + 2 columns each */
+#define TEXT_STRIP_MAX_RUNS     8     /* texts (each with its own color) in the strip */
+#define TEXT_STRIP_COLUMN_BITS  5     /* pixels of row 0-4 */
+#define TEXT_STRIP_PIXELS       0b00011111
+
+/******************************************************************************************************************************
+*
+* CLASS  :  TextStrip
+*
+* Text rendered once into a strip of columns (5 bits per column, packed: the pixels of row 0-4), so scrolling is only
+* copying the visible columns to the LED panel. The cost of each frame does not depend on the length of the text. The color
+* is stored once per text (a 'run' of columns, see addText). The strip repeats itself: after the last column the first
+* column follows.
+*
+*******************************************************************************************************************************/
+class TextStrip {
+  public:
+    /**
+    * Constructor.
+    */
+    TextStrip();
+    void clear();
+    int addText(LedPanel* lp, const char* txt, byte clr);  /* render text at the end of the strip, returns its width */
+    void addSpace(int columns);
+    void draw(LedPanel* lp, int x);       /* first column of strip at column x of the LED panel (x can be negative) */
+
+    int width;                            /* columns used */
+
+  private:
+    byte _columns[(TEXT_STRIP_MAX_COLUMNS * TEXT_STRIP_COLUMN_BITS + 7) / 8 + 1];  /* +1: a column is read as 2 bytes */
+    uint16_t _runStarts[TEXT_STRIP_MAX_RUNS];  /* first column of each run */
+    byte _runColors[TEXT_STRIP_MAX_RUNS];
+    byte _runCount;
+
+    void _addColumn(byte bits);
+    byte _getColumn(int i);
+};
+
+
+
+
+#endif // TextStrip_h
@@ -0,0 +1,202 @@
+#include "Ws2812.h"
+#include "HardwDefs.h"
+
+
+Ws2812::Ws2812() {
+  for (int i = 0; i < WS2812_INPUT_SIZE; i++) _input_for_asm[i] = 0ul;
+  for (int row = 0; row < WS2812_MAX_ROWS; row++) { _rowOffset[row] = 0; _rowPalette[row] = 0ul; }
+  _input_for_asm[5] = (uint32_t)(uintptr_t)_rowPalette;          /* ref. to palette of each row */
+  _input_for_asm[10] = (uint32_t)(uintptr_t)_rowOffset;          /* ref. to offset of each row */
+  _palette = NULL;
+}
+
+
+/******************************************************************************************************************************
+* Sets up both data pins (must be on the same PORT) and the data for the asm routine. Palette: see setPalette().
+*******************************************************************************************************************************/
+void Ws2812::_begin(int pin1, int pin2, const byte* colorIdx, const uint16_t* order, int ledsPerStrip) {
+  pinMode(pin1, OUTPUT);                 /* LEDstrip line 1 */
+  digitalWrite(pin1, LOW);
+  pinMode(pin2, OUTPUT);                 /* LEDstrip line 2 (same pin, if only 1 LED strip) */
+  digitalWrite(pin2, LOW);
+
+  _input_for_asm[0] = 0ul;                                         /* bitmask: none            */
+  _input_for_asm[1] = 1ul << g_APinDescription[pin1].ulPin;        /* bitmask: only line 1     */
+  _input_for_asm[2] = 1ul << g_APinDescription[pin2].ulPin;        /* bitmask: only line 2     */
+  _input_for_asm[3] = _input_for_asm[1] | _input_for_asm[2];       /* bitmask: line 1 + line 2 */
+
+  _input_for_asm[4] = (uint32_t)(uintptr_t)colorIdx;              /* ref. to LED-array        */
+
+  byte port = g_APinDescription[pin1].ulPort;
+  _input_for_asm[6] = (uint32_t)(uintptr_t)&(PORT->Group[port].OUTCLR.reg);  /* store 'Clear' address */
+  _input_for_asm[7] = (uint32_t)(uintptr_t)&(PORT->Group[port].OUTSET.reg);  /* store 'Set' address   */
+  _input_for_asm[8] = (uint32_t)(uintptr_t)order;                 /* order in which LEDs are wired */
+  _input_for_asm[9] = (uint32_t)(-32 * ledsPerStrip);              /* loop counter */
+}
+
+
+void Ws2812::setPalette(const uint32_t* colors) {
+  _palette = colors;
+  for (int row = 0; row < WS2812_MAX_ROWS; row++) setRowOffset(row, _rowOffset[row]);
+}
+
+
+/* O(1): only the palette pointer of the row changes (color index + offset = palette pointer + offset) */
+void Ws2812::setRowOffset(int row, byte offset) {
+  if (row < 0 || row >= WS2812_MAX_ROWS) return;
+  _rowOffset[row] = offset;
+  _rowPalette[row] = (uint32_t)(uintptr_t)(_palette + offset);
+}
+
+
+const byte* Ws2812::getRowOffsets() {
+  return _rowOffset;
+}
+
+
+const uint32_t* Ws2812::getPalette() {
+  return _palette;
+}
+
+
+
+/******************************************************************************************************************************
+* Writes indexed colors to two LED-strips (WS2812B)                         WS2812B:  to send LOW/0  : high 0.4us, low 0.85us
+*                                                                                     to send HIGH/1 : high 0.8us, low 0.45us
+*                                                                                     to send RESET  : low for 50us (minimum)
+* input: _input_for_asm[] array (11 values of type uint32_t):
+*            _input_for_asm[0]: always 0                                              binary: 00000000000000000000000000000000
+*            _input_for_asm[1]: bit-mask of data-pin of LED strip 1         binary (example): 00000000000000000000100000000000
+*            _input_for_asm[2]: bit-mask of data-pin of LED strip 2         binary (example): 00000000000000000000010000000000
+*            _input_for_asm[3]: bit-mask of data-pin of both LED strips     binary (example): 00000000000000000000110000000000
+*            _input_for_asm[4]: pointer to a byte-array with color-index per LED (e.g. LedPanel: 305 bytes for 61-key piano)
+*            _input_for_asm[5]: pointer to _rowPalette : for each row a pointer to the colors used (palette + row offset)
+*            _input_for_asm[6]: I/O address of port to set the LED strip DATA lines LOW (OUTCLR)
+*            _input_for_asm[7]: I/O address of port to set the LED strip DATA lines HIGH (OUTSET)
+*            _input_for_asm[8]: pointer to order table : LED index + row of each LED of both strips (e.g. LedStripOrder::order[])
+*            _input_for_asm[9]: -32 * LEDs per strip : loop counter (negative and shifted, see 'mainLoop')
+*            _input_for_asm[10]: pointer to _rowOffset : offset of each row (1 byte), to keep each LED within its color
+* Only the bit timing below ('writeLED') is hand-written: any number of LEDs, in any order, is written by the same code.
+* Interrupts must be disabled by the caller (e.g. LedPanel::writeLeds_asm()).
+*******************************************************************************************************************************/
+void Ws2812::write()
+{
+#ifndef LEDPANEL_SIMULATOR
+    asm volatile(
+    "LDR  R0, [%[data], #36]   \n"          // see _input_for_asm[9]. Counter R0 = -32 * LEDs per strip (negative and shifted)
+    "LDR  R5, [%[data], #32]   \n"          // see _input_for_asm[8]. R5 = pointer to order table (2 bytes per entry)
+
+    "LDR  R1, [%[data], #24]   \n"          // see _input_for_asm[6]
+    "MOV  R10, R1              \n"          // R10 = I/O address to drive lines LOW (addrClr)
+
+    "LDR  R1, [%[data], #28]   \n"          // see _input_for_asm[7]
+    "MOV  R6, R1               \n"          // R6 = I/O address to drive lines HIGH (addrSet)
+
+"mainLoop%=:\n"                            // each iteration writes 1 LED of both LED strips (order: see order table)
+    "LDRH R1, [R5, #0]         \n"          // R1 = entry of next LED of strip 1: LED index (bits 0-12) + row (bits 13-15)
+    "LDRH R2, [R5, #2]         \n"          // R2 = entry of next LED of strip 2 (an LED 'off' if strip 2 has no more LEDs)
+    "ADD  R5, R5, #4           \n"          // step to the next pair of entries
+    "LSR  R4, R1, #13          \n"          // R4 = row of both LEDs (see WS2812_ROW_SHIFT)
+    "LDR  R3, [%[data], #40]   \n"          // see _input_for_asm[10]
+    "LDRB R3, [R3, R4]         \n"
+    "MOV  R9, R3               \n"          // R9 = offset (dimming) of this row
+    "LSL  R4, R4, #2           \n"
+    "LDR  R3, [%[data], #20]   \n"          // see _input_for_asm[5]
+    "LDR  R3, [R3, R4]         \n"
+    "MOV  R8, R3               \n"          // R8 = pointer to colors-array of this row (4 bytes for each color)
+    "LSL  R1, R1, #19          \n"
+    "LSR  R1, R1, #19          \n"          // R1 = LED index of strip 1 (row removed)
+    "LSL  R2, R2, #19          \n"
+    "LSR  R2, R2, #19          \n"          // R2 = LED index of strip 2 (row removed)
+    "LDR  R3, [%[data], #16]   \n"          // see _input_for_asm[4]. R3 = pointer to array of indexed colors, 1 byte per LED
+    "LDRB R1, [R3, R1]         \n"          // R1 = color index for LED strip 1
+    "LDRB R2, [R3, R2]         \n"          // R2 = color index for LED strip 2
+
+    "MOV  R3, #7               \n"          // color index + row offset must stay within the 8 entries of the color:
+    "AND  R3, R3, R1           \n"          // (line 1) R3 = dimming of the color index itself (0..7)
+    "ADD  R3, R3, R9           \n"          // (line 1) + row offset
+    "SUB  R3, R3, #7           \n"          // (line 1) R3 = steps beyond the darkest entry of the color
+    "BLE  inColor1%=           \n"
+    "SUB  R1, R1, R3           \n"          // (line 1) R1 + row offset = darkest entry
+"inColor1%=:\n"
+    "MOV  R3, #7               \n"
+    "AND  R3, R3, R2           \n"          // (line 2) same as line 1
+    "ADD  R3, R3, R9           \n"
+    "SUB  R3, R3, #7           \n"
+    "BLE  inColor2%=           \n"
+    "SUB  R2, R2, R3           \n"
+"inColor2%=:\n"
+    "BL   writeLED%=           \n"
+
+    ".syntax unified           \n"
+    "ADDS R0, R0, #32          \n"          // increase counter (low 5 bits have other counting function)
+    ".syntax divided           \n"
+
+    "BNE   mainLoop%=          \n"          // if counter <> 0, write the next LED of both LED strips
+    
+    "B   finished%=            \n"     // Finished: all LEDs written!
+    
+"writeLED%=:\n"                        // looks up two RGB values and writes each of the 24 bits of both to two separate WS2812B-lines
+    "LSL  R1, R1, #2    \n"            // (line 1) R1 = offset in color table (0, 4, 8, etc)
+    "ADD  R1, R1, R8    \n"            // (line 1) R1 = pointer to the right color (4-byte value)
+    "LDR  R1, [R1]      \n"            // (line 1) R1 is now 24-bit color (coded as 0xGGRRBB00)
+    "LSL  R2, R2, #2    \n"            // (line 2) R2 = offset in color table (0, 4, 8, etc)
+    "ADD  R2, R2, R8    \n"            // (line 2) R2 = pointer to the right color (4-byte value)
+    "LDR  R2, [R2]      \n"            // (line 2) R2 is now 24-bit color (coded as 0xGGRRBB00)
+    
+    "ADD R0, R0, #24    \n"            // set counter to 24 (for each bit of RGB-color)
+"writeBit%=:\n"  
+    "LDR  R3, [%[data], #12]   \n"     // see _input_for_asm[3]. R3 is pinMask for both lines
+    "STR  R3, [R6]             \n"     // drive both lines HIGH
+
+//    "nop\n"                            /* almost no NOPs needed, because of code below */ 
+   
+    ".syntax unified         \n"
+    "LSLS R1, R1, #1         \n"       // shift bit out of R1 (line 1) into carry flag
+    ".syntax divided         \n"
+    "SBC  R4, R4,R4          \n"       // R4=0xFFFFFFFF (if carry=0) or R4=0 (if carry=1)
+    "MOV  R3, #4             \n"
+    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 4 (shifted bit was 0)
+    "MOV  R9, R3             \n"
+    
+    ".syntax unified         \n"
+    "LSLS R2, R2, #1         \n"       // shift bit out of R2 (line 2) into carry flag
+    ".syntax divided         \n"
+    "SBC  R4, R4, R4         \n"       // R4=0xFFFFFFFF (if carry=0) or R4=0 (if carry=1)
+    "MOV  R3, #8             \n"
+    "AND  R3, R3, R4         \n"       // R3 is 0 (shifted bit was 1) or 8 (shifted bit was 0)
+    "ADD  R3, R3, R9         \n"       // R3 is offset 0, 4, 8 or 12 (to get the right pinMask)
+
+    "LDR  R3, [%[data], R3]  \n"       // R3 = pinMask, for the lines that send 0-bit (must be driven LOW after 0.4us)
+	                                   // see _input_for_asm[x] where x = 0/1/2/3
+
+    "MOV  R4, R10            \n"       // R4 = addrClr (I/O address to drive lines low)
+    "STR  R3, [R4]           \n"       // drive lines (only lines that send 0-bit) LOW
+    
+    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up approx. 0.8us */ 
+    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
+ //   "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"
+ //   "nop\n" "nop\n"
+   
+    "LDR  R3, [%[data], #12] \n"       // R3 is pinMask for both lines
+    "STR  R3, [R4]           \n"       // drive all lines low (also lines that send 1-bit, this is after approx. 0.8us)
+
+    "nop\n" "nop\n" "nop\n" "nop\n" "nop\n"     /*  NOPs here to fill up some time */ 
+ //   "nop\n" "nop\n"
+     
+    "MOV  R3, #31                   \n"     // mask for counter, because R3 has double counting function
+    "SUB R0, R0, #1                 \n"     // decrease bit-counter by 1
+    ".syntax unified                \n"
+    "ANDS R3, R0, R3                \n"     // are lower 5-bits of counter all zero?
+    ".syntax divided\n"
+
+    "BNE   writeBit%=               \n"     // write another bit while bit-counter >= 1
+    "MOV   PC, LR                   \n"     // return to caller
+
+"finished%=:\n"    
+    :
+    : [data] "r" (_input_for_asm)
+    : "r0", "r1", "r2", "r3", "r4", "r5","r6", "r8", "r9", "r10", "lr", "cc"  /* clobbers (lr: 'BL writeLED') */
+    );
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef Ws2812_h
+#define Ws2812_h
+
+#include <Arduino.h>
+
+#define WS2812_INPUT_SIZE  11   /* uint32_t values passed to the asm routine (see Ws2812.cpp) */
+#define WS2812_MAX_ROWS     8   /* rows that can have their own palette offset (dimming) */
+#define WS2812_ROW_SHIFT   13   /* entry of order table: LED index in bits 0-12, row in bits 13-15 */
+#define WS2812_INDEX_MASK  ((1 << WS2812_ROW_SHIFT) - 1)
+
+constexpr uint32_t ledColor(byte r, byte g, byte b) {  /* color of a palette: 0xGGRRBB00 (order of the WS2812B bits) */
+  return ((uint32_t)g << 24) | ((uint32_t)r << 16) | ((uint32_t)b << 8);
+}
+
+/* Color index with a row offset (dimming): stays within the 8 entries of its color, an already dimmed index (e.g.
+*  COLOR_IDX_xxx + 5) with offset 4 becomes the darkest entry (COLOR_IDX_xxx + 7), not an entry of the next color. */
+constexpr byte dimmedColorIdx(byte colorIdx, byte offset) {
+  return (colorIdx & ~7) | (((colorIdx & 7) + offset > 7) ? 7 : (colorIdx & 7) + offset);
+}
+
+/******************************************************************************************************************************
+*
+* CLASS  :  Ws2812
+*
+* Writes indexed colors to 1 or 2 WS2812B LED strips on the same PORT (2 strips are written at the same time, bit by bit).
+* The only copy of the cycle-exact asm routine: used by the LED panel and by the metronome.
+* Each LED has a color index (1 byte); the palette (4 bytes per color: 0xGGRRBB00) can be changed any time (brightness).
+* Each row can have an offset that is added to the color index of its LEDs while writing (dimming: 0..7), so a whole
+* row is dimmed without changing any color index. The result stays within the color (see dimmedColorIdx).
+* The order of the LEDs is given by a table with an entry for each LED of both strips: {strip 1, strip 2, strip 1, ..}.
+* An entry is the LED index and the row of the LED (see WS2812_ROW_SHIFT). Both LEDs of a pair must be on the same row.
+* write() must be called with interrupts disabled (pulse timing), so that more strips can be written in 1 'blackout'.
+* Use Ws2812Strips<strips, ledsPerStrip> (below).
+*
+*******************************************************************************************************************************/
+class Ws2812 {
+  public:
+    /**
+    * Constructor.
+    */
+    Ws2812();
+    void setPalette(const uint32_t* colors);
+    const uint32_t* getPalette();
+    void setRowOffset(int row, byte offset);  /* added to color index of all LEDs of this row (0..7, see dimmedColorIdx) */
+    const byte* getRowOffsets();              /* WS2812_MAX_ROWS offsets */
+    void write();                            /* interrupts must be disabled, reset (LOW for 50 us) is up to the caller */
+
+  protected:
+    void _begin(int pin1, int pin2, const byte* colorIdx, const uint16_t* order, int ledsPerStrip);
+
+  private:
+    uint32_t _input_for_asm[WS2812_INPUT_SIZE];  /* used to pass data to assembler routine */
+    const uint32_t* _palette;
+    byte _rowOffset[WS2812_MAX_ROWS];
+    uint32_t _rowPalette[WS2812_MAX_ROWS];       /* palette + offset for each row (pointers of 32 bits), see _input_for_asm[5] */
+};
+
+
+/******************************************************************************************************************************
+* Ws2812 for a number of strips (1 or 2) with a number of LEDs per strip. With 1 strip, pin2 is ignored and the order
+* table has each LED index twice (both 'lines' are the same pin).
+*******************************************************************************************************************************/
+template<int STRIPS, int LEDS_PER_STRIP_T> class Ws2812Strips : public Ws2812 {
+  public:
+    static_assert(STRIPS == 1 || STRIPS == 2, "Ws2812 writes 1 or 2 LED strips");
+    static_assert(LEDS_PER_STRIP_T > 0, "Ws2812 needs at least 1 LED per strip");
+
+    void begin(int pin1, int pin2, const byte* colorIdx, const uint16_t* order) {
+      _begin(pin1, (STRIPS == 2) ? pin2 : pin1, colorIdx, order, LEDS_PER_STRIP_T);
+    }
+};
+
+
+
+#endif // Ws2812_h
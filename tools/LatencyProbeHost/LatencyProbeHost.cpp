@@ -0,0 +1,136 @@
+/******************************************************************************************************************************
+* LatencyProbeHost  -  host test (PC) of the arithmetic of the LatencyProbe, without the Arduino
+*******************************************************************************************************************************
+* The LatencyProbe of '1Main' is built against the Arduino shim of LedSimHost (virtual time). MIDI bytes are fed to the
+* probe one by one (as MidiInterface does), and time is moved by hand between RX, frameComposed() and frameShown(), so
+* each stored latency is known exactly. Checked: NoteOn parsing (running status, velocity 0, real-time bytes in between),
+* the compose/shown deltas, the time missed while the LED panel is written (LedPanel::missedMillis), overflows, the ring
+* and the percentiles. The latency on the Arduino itself is measured by test_KeyToLedLatency (5Tests.ino).
+*
+* Build and run (from this directory):
+*     g++ -std=gnu++11 -DLEDPANEL_SIMULATOR -I../LedSimHost -I../../1Main LatencyProbeHost.cpp ../LedSimHost/Arduino.cpp \
+*         ../../1Main/{LatencyProbe,LedPanel,LedPData,Ws2812,LedSim,Metronome,Midi,Recorder}.cpp -o LatencyProbeHost
+*     ./LatencyProbeHost
+*******************************************************************************************************************************/
+#include <Arduino.h>
+#include "LedPanel.h"
+#include "LatencyProbe.h"
+
+LedPanel     ledPanel;
+LatencyProbe probe(&ledPanel);
+int errors = 0;
+
+
+static void check(bool ok, const char* what) {
+  if (ok) return;
+  errors++;
+  printf("FAILED: %s\n", what);
+}
+
+
+static void receive(const byte* bytes, int size) {
+  for (int i = 0; i < size; i++) probe.receiveByte(bytes[i]);
+}
+
+
+/* a frame after 'composeMicros', shown 'writeMicros' later: interrupts disabled while written, millis() missed 'missed' ms */
+static void frame(uint32_t composeMicros, uint32_t writeMicros, uint32_t missed) {
+  advanceMicros(composeMicros);
+  probe.frameComposed();
+  advanceMicros(writeMicros);
+  ledPanel.missedMillis += missed;
+  probe.frameShown();
+}
+
+
+/* the latest sample in the ring: p50 = p99 = max when it is the only one */
+static void checkOnlySample(uint16_t compose, uint16_t shown, const char* what) {
+  uint16_t c[PROBE_PERCENTILES], s[PROBE_PERCENTILES];
+  probe.getPercentiles(false, c);
+  probe.getPercentiles(true, s);
+  bool ok = (probe.count == 1);
+  for (int i = 0; i < PROBE_PERCENTILES; i++) ok = ok && (c[i] == compose) && (s[i] == shown);
+  check(ok, what);
+}
+
+
+static void testNoteOn() {
+  const byte noteOn[] = { 0x90, 60, 100 };
+  probe.start();
+  receive(noteOn, sizeof(noteOn));
+  frame(1500, 3000, 0);
+  checkOnlySample(1500, 4500, "NoteOn: compose and shown after RX");
+
+  probe.start();
+  frame(1500, 3000, 0);
+  check(probe.count == 0, "frame without key: no sample");
+
+  const byte noteOff[] = { 0x80, 60, 64,  0x90, 60, 0 /* velocity 0 is a note-off */,  0xB0, 64, 127 /* sustain */ };
+  receive(noteOff, sizeof(noteOff));
+  frame(1500, 3000, 0);
+  check(probe.count == 0, "note-off, NoteOn with velocity 0, control change: no sample");
+
+  const byte runningStatus[] = { 0x91, 60, 100, 64, 100 };   /* 2nd key without status byte, channel 2 */
+  receive(runningStatus, 3);
+  advanceMicros(2000);
+  receive(runningStatus + 3, 2);                              /* the last key before the frame counts */
+  frame(1000, 3000, 0);
+  checkOnlySample(1000, 4000, "running status: last key counts");
+
+  probe.start();
+  const byte realTime[] = { 0x90, 0xF8 /* clock */, 62, 0xFE /* active sensing */, 90 };
+  receive(realTime, sizeof(realTime));
+  frame(700, 3000, 0);
+  checkOnlySample(700, 3700, "real-time bytes in between a NoteOn");
+
+  probe.stop();
+  receive(noteOn, sizeof(noteOn));
+  frame(700, 3000, 0);
+  check(probe.count == 1, "stopped: no sample");
+}
+
+
+static void testMissedMillis() {
+  /* writeLeds_asm() disables interrupts: micros() does not move, the LED panel counts the missed milliseconds */
+  probe.start();
+  probe.noteDue();
+  frame(800, 0, 3);
+  checkOnlySample(800, 3800, "missedMillis is part of the latency");
+}
+
+
+static void testOverflow() {
+  probe.start();
+  probe.noteDue();
+  frame(70000, 1000, 0);                                      /* more than 65 ms */
+  checkOnlySample(0xFFFF, 0xFFFF, "overflow is stored as 65535");
+  check(probe.overflows == 1, "overflow is counted");
+}
+
+
+static void testRingAndPercentiles() {
+  probe.start();
+  for (int i = 0; i < PROBE_SAMPLES_MAX + 28; i++) {         /* the first 28 samples are overwritten */
+    probe.noteDue();
+    uint32_t latency = (i < 28) ? 60000 : ((i - 28) * 37 % PROBE_SAMPLES_MAX + 1) * 100;  /* 100 .. 12800 us, shuffled */
+    frame(latency / 2, latency - latency / 2, 0);
+  }
+  check(probe.count == PROBE_SAMPLES_MAX, "ring is full");
+  uint16_t s[PROBE_PERCENTILES];
+  probe.getPercentiles(true, s);
+  /* sorted: 100, 200, .., 12800. p50 = sorted[127 * 50 / 100 = 63], p99 = sorted[127 * 99 / 100 = 125] */
+  check(s[0] == 6400 && s[1] == 12600 && s[2] == 12800, "percentiles of shown");
+  probe.getPercentiles(false, s);
+  check(s[0] == 3200 && s[1] == 6300 && s[2] == 6400, "percentiles of compose");
+}
+
+
+int main() {
+  testNoteOn();
+  testMissedMillis();
+  testOverflow();
+  testRingAndPercentiles();
+  printf("Errors: %d\n", errors);
+  printf("%s\n", errors == 0 ? "OK" : "FAILED");
+  return errors == 0 ? 0 : 1;
+}
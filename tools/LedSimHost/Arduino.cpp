@@ -0,0 +1,179 @@
+#include <Arduino.h>
+#include <SD.h>
+#include <unistd.h>
+
+
+
+/******************************************************************************************************************************
+* Virtual time (see Arduino.h)
+*******************************************************************************************************************************/
+static uint64_t _nowMicros = 0;
+
+uint32_t millis() { return (uint32_t)(_nowMicros / 1000); }
+uint32_t micros() { return (uint32_t)_nowMicros; }
+void delay(uint32_t ms) { _nowMicros += (uint64_t)ms * 1000; }
+void delayMicroseconds(uint32_t us) { _nowMicros += us; }
+void advanceMicros(uint32_t us) { _nowMicros += us; }
+
+void pinMode(int pin, int mode) {}
+void digitalWrite(int pin, int val) {}
+int digitalRead(int pin) { return HIGH; }   /* pull-up: buttons and pedals not pressed */
+long random(long howsmall, long howbig) { return (howbig <= howsmall) ? howsmall : howsmall + rand() % (howbig - howsmall); }
+long random(long howbig) { return random(0, howbig); }
+
+char* itoa(int value, char* buf, int radix) {
+  sprintf(buf, (radix == HEX) ? "%x" : "%d", value);
+  return buf;
+}
+
+char* strupr(char* s) {
+  for (char* c = s; *c != 0; c++) *c = toupper(*c);
+  return s;
+}
+
+
+/******************************************************************************************************************************
+* Print
+*******************************************************************************************************************************/
+size_t Print::write(const uint8_t* buf, size_t size) {
+  size_t n = 0;
+  while (size-- > 0) n += write(*buf++);
+  return n;
+}
+
+static const char* _format(int base, bool isLong, bool isSigned) {
+  if (base == HEX) return isLong ? "%lx" : "%x";
+  if (isLong) return isSigned ? "%ld" : "%lu";
+  return isSigned ? "%d" : "%u";
+}
+
+size_t Print::print(const char* s)                  { return write(s); }
+size_t Print::print(char c)                         { return write((uint8_t)c); }
+size_t Print::print(int n, int base)                { char b[24]; sprintf(b, _format(base, false, true), n);  return write(b); }
+size_t Print::print(unsigned int n, int base)       { char b[24]; sprintf(b, _format(base, false, false), n); return write(b); }
+size_t Print::print(long n, int base)               { char b[24]; sprintf(b, _format(base, true, true), n);   return write(b); }
+size_t Print::print(unsigned long n, int base)      { char b[24]; sprintf(b, _format(base, true, false), n);  return write(b); }
+size_t Print::print(double n)                       { char b[32]; sprintf(b, "%.2f", n); return write(b); }
+size_t Print::println()                             { return write("\r\n"); }
+size_t Print::println(const char* s)                { return print(s) + println(); }
+size_t Print::println(char c)                       { return print(c) + println(); }
+size_t Print::println(int n, int base)              { return print(n, base) + println(); }
+size_t Print::println(unsigned int n, int base)     { return print(n, base) + println(); }
+size_t Print::println(long n, int base)             { return print(n, base) + println(); }
+size_t Print::println(unsigned long n, int base)    { return print(n, base) + println(); }
+size_t Print::println(double n)                     { return print(n) + println(); }
+
+
+/******************************************************************************************************************************
+* Serial (stdout) and Serial1 (MIDI: bytes from the host program)
+*******************************************************************************************************************************/
+HardwareSerial Serial(stdout);
+HardwareSerial Serial1(NULL);
+
+HardwareSerial::HardwareSerial(FILE* out) {
+  _out = out;
+  _rxHead = 0;
+  _rxCount = 0;
+}
+
+void HardwareSerial::begin(long baud) {}
+int HardwareSerial::available() { return _rxCount; }
+int HardwareSerial::availableForWrite() { return SERIAL_BUFFER_SIZE; }
+void HardwareSerial::flush() { if (_out != NULL) fflush(_out); }
+
+int HardwareSerial::read() {
+  if (_rxCount == 0) return -1;
+  byte b = _rx[_rxHead];
+  _rxHead = (_rxHead + 1) % SERIAL_BUFFER_SIZE;
+  _rxCount--;
+  return b;
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  if (_out != NULL) fputc(b, _out);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t size) {
+  if (_out != NULL) fwrite(buf, 1, size, _out);
+  return size;
+}
+
+void HardwareSerial::receive(byte b) {
+  if (_rxCount >= SERIAL_BUFFER_SIZE - 1) return;   /* full, like the Arduino core */
+  _rx[(_rxHead + _rxCount) % SERIAL_BUFFER_SIZE] = b;
+  _rxCount++;
+}
+
+
+/******************************************************************************************************************************
+* SAMD21 registers and pins
+*******************************************************************************************************************************/
+PinDescription g_APinDescription[32];
+static PortType _port;          PortType* PORT = &_port;
+static GclkType _gclk;          GclkType* GCLK = &_gclk;
+static TccType _tcc0;           TccType* TCC0 = &_tcc0;
+static SercomType _sercom5;     SercomType* SERCOM5 = &_sercom5;
+volatile uint32_t REG_GCLK_GENDIV, REG_GCLK_GENCTRL, REG_GCLK_CLKCTRL;
+volatile uint32_t REG_TCC0_WAVE, REG_TCC0_PER, REG_TCC0_CCB0, REG_TCC0_CTRLA;
+
+
+/******************************************************************************************************************************
+* SD card: files of the current directory
+*******************************************************************************************************************************/
+SDClass SD;
+
+File::File(FILE* f, const char* name) {
+  _f = f;
+  snprintf(_name, sizeof(_name), "%s", name);
+}
+
+int File::read() {
+  return (_f == NULL) ? -1 : fgetc(_f);
+}
+
+int File::read(void* buf, size_t size) {
+  return (_f == NULL) ? -1 : (int)fread(buf, 1, size, _f);
+}
+
+int File::available() {
+  if (_f == NULL) return 0;
+  long pos = ftell(_f);
+  fseek(_f, 0, SEEK_END);
+  long end = ftell(_f);
+  fseek(_f, pos, SEEK_SET);
+  return (int)(end - pos);
+}
+
+size_t File::write(uint8_t b) {
+  return (_f == NULL) ? 0 : fwrite(&b, 1, 1, _f);
+}
+
+size_t File::write(const uint8_t* buf, size_t size) {
+  return (_f == NULL) ? 0 : fwrite(buf, 1, size, _f);
+}
+
+bool File::seek(uint32_t pos) { return _f != NULL && fseek(_f, pos, SEEK_SET) == 0; }
+uint32_t File::position() { return (_f == NULL) ? 0 : (uint32_t)ftell(_f); }
+uint32_t File::size() { return position() + available(); }
+void File::flush() { if (_f != NULL) fflush(_f); }
+char* File::name() { return _name; }
+
+void File::close() {
+  if (_f != NULL) fclose(_f);
+  _f = NULL;
+}
+
+File SDClass::open(const char* path, int mode) {
+  const char* fmode = "rb";
+  if (mode & O_WRITE) {
+    if (mode & O_APPEND) fmode = "ab+";
+    else if ((mode & O_TRUNC) || !exists(path)) fmode = "wb+";
+    else fmode = "rb+";
+  }
+  const char* name = strrchr(path, '/');
+  return File(fopen(path, fmode), (name != NULL) ? name + 1 : path);
+}
+
+bool SDClass::exists(const char* path) { return access(path, F_OK) == 0; }
+bool SDClass::remove(const char* path) { return ::remove(path) == 0; }
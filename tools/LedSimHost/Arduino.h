@@ -0,0 +1,153 @@
+#ifndef Arduino_h
+#define Arduino_h
+
+/******************************************************************************************************************************
+* Arduino shim for the host (Linux), only what the Piano Teacher sources in '1Main' need to run with LEDPANEL_SIMULATOR.
+*  - Time is virtual: millis() and micros() only move when the host program calls advanceMicros() (or delay()), so a song
+*    can be simulated faster than real time.
+*  - Serial writes to stdout. Serial1 (MIDI) takes bytes from the host program (see HardwareSerial::receive), bytes that
+*    are sent to the piano are dropped.
+*  - Registers of the SAMD21 (PORT, GCLK, TCC0, SERCOM5) are plain variables: writes are kept, nothing happens.
+*******************************************************************************************************************************/
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <strings.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define HIGH            1
+#define LOW             0
+#define INPUT           0
+#define OUTPUT          1
+#define INPUT_PULLUP    2
+#define DEC             10
+#define HEX             16
+#define A0              15
+#define A1              16
+#define A2              17
+#define A3              18
+#define A4              19
+#define A5              20
+#define A6              21
+#define SDCARD_SS_PIN   28
+#define SERIAL_BUFFER_SIZE  64   /* same as the Arduino core of the SAMD21 */
+
+#define min(a,b)               ((a)<(b)?(a):(b))
+#define max(a,b)               ((a)>(b)?(a):(b))
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+/* virtual time */
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void advanceMicros(uint32_t us);          /* host: time moves on */
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int val);
+int digitalRead(int pin);
+long random(long howsmall, long howbig);
+long random(long howbig);
+inline void __disable_irq() {}
+inline void __enable_irq() {}
+char* itoa(int value, char* buf, int radix);
+char* strupr(char* s);
+
+
+/******************************************************************************************************************************
+* Print: same overloads as the Arduino core, all output goes through write()
+*******************************************************************************************************************************/
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t b) = 0;
+    virtual size_t write(const uint8_t* buf, size_t size);
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const char* s);
+    size_t print(char c);
+    size_t print(int n, int base = DEC);
+    size_t print(unsigned int n, int base = DEC);
+    size_t print(long n, int base = DEC);
+    size_t print(unsigned long n, int base = DEC);
+    size_t print(double n);
+    size_t println();
+    size_t println(const char* s);
+    size_t println(char c);
+    size_t println(int n, int base = DEC);
+    size_t println(unsigned int n, int base = DEC);
+    size_t println(long n, int base = DEC);
+    size_t println(unsigned long n, int base = DEC);
+    size_t println(double n);
+};
+
+
+class HardwareSerial : public Print {
+  public:
+    HardwareSerial(FILE* out);            /* out NULL: bytes written are dropped */
+    void begin(long baud);
+    int available();
+    int read();
+    int availableForWrite();
+    void flush();
+    operator bool() { return true; }
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    using Print::write;
+    void receive(byte b);                 /* host: byte can be read as if it was received (dropped when buffer full) */
+
+  private:
+    FILE* _out;
+    byte _rx[SERIAL_BUFFER_SIZE];
+    int _rxHead, _rxCount;
+};
+
+extern HardwareSerial Serial, Serial1;
+
+
+/******************************************************************************************************************************
+* SAMD21 registers and pins (see file header)
+*******************************************************************************************************************************/
+struct PinDescription { int ulPort; int ulPin; };
+extern PinDescription g_APinDescription[];
+
+struct PortReg { volatile uint32_t reg; };
+struct PortPinCfg { struct { unsigned PMUXEN : 1; } bit; };
+struct PortPmux { struct { unsigned PMUXE : 4; unsigned PMUXO : 4; } bit; };
+struct PortGroup { PortReg OUTCLR, OUTSET, OUTTGL, IN; PortPinCfg PINCFG[32]; PortPmux PMUX[16]; };
+struct PortType { PortGroup Group[2]; };
+extern PortType* PORT;
+
+struct GclkType { struct { struct { unsigned SYNCBUSY : 1; } bit; } STATUS; struct { uint32_t reg; } CLKCTRL; };
+extern GclkType* GCLK;
+struct TccType { struct { struct { unsigned WAVE : 1, PER : 1, CCB0 : 1, ENABLE : 1; } bit; } SYNCBUSY; };
+extern TccType* TCC0;
+extern volatile uint32_t REG_GCLK_GENDIV, REG_GCLK_GENCTRL, REG_GCLK_CLKCTRL;
+extern volatile uint32_t REG_TCC0_WAVE, REG_TCC0_PER, REG_TCC0_CCB0, REG_TCC0_CTRLA;
+#define GCLK_GENDIV_DIV(x)          (x)
+#define GCLK_GENDIV_ID(x)           (x)
+#define GCLK_GENCTRL_ID(x)          (x)
+#define GCLK_GENCTRL_IDC            0
+#define GCLK_GENCTRL_GENEN          0
+#define GCLK_GENCTRL_SRC_DFLL48M    0
+#define GCLK_CLKCTRL_CLKEN          0
+#define GCLK_CLKCTRL_GEN_GCLK4      0
+#define GCLK_CLKCTRL_ID_TCC0_TCC1   0
+#define PORT_PMUX_PMUXE_E_Val       4
+#define TCC_WAVE_WAVEGEN_NPWM       2
+#define TCC_CTRLA_PRESCALER_DIV16   0x400
+#define TCC_CTRLA_ENABLE            2
+
+struct SercomType { struct { struct { uint16_t reg; } STATUS; } USART; };
+extern SercomType* SERCOM5;
+#define SERCOM_USART_STATUS_FERR    0x02
+#define SERCOM_USART_STATUS_BUFOVF  0x04
+
+
+
+#endif // Arduino_h
@@ -0,0 +1,150 @@
+/******************************************************************************************************************************
+* LedSimHost  -  host tool (PC), to play a song with practice 2 or 3 and see the LED panel, without the Arduino
+*******************************************************************************************************************************
+* The Piano Teacher sources in '1Main' are built with LEDPANEL_SIMULATOR (see HardwDefs.h and LedSim.h) against a small
+* Arduino shim (Arduino.h, SD.h in this directory). Each frame of the LED panel is rendered to stdout, as ANSI text or
+* PPM images. Time is virtual: the song is played as fast as the host can, or paced in real time with -r.
+*
+* Build and run (from this directory):
+*     g++ -std=gnu++11 -DLEDPANEL_SIMULATOR -I. -I../../1Main LedSimHost.cpp Arduino.cpp ../../1Main/{APlayer2,APlayer3,\
+*         Entities,CapacityPlanner,Metronome,Gloves,MidiClock,Midi,LedPanel,LedPData,Ws2812,LedSim,LatencyProbe,\
+*         Recorder}.cpp -o LedSimHost
+*     ./LedSimHost -p 3 SONG01.TXT                                  (ANSI, in a terminal)
+*     ./LedSimHost -p 2 -f ppm -l timing.csv SONG01.TXT | ffmpeg -f image2pipe -c:v ppm -i - song.mp4
+*
+* Options:  -p 2|3 practice (default 3),  -f ansi|ppm (default ansi),  -t tempo factor % (default 100),
+*           -a animation speed of practice 3 (default 2),  -s max seconds of the song (default: till the end),
+*           -g gain of the colors (default 4),  -l timing log (CSV, see LedSim.h),  -r real-time pacing.
+* Practice 2 waits for a piano key before the song starts: the host sends one (NoteOn on Serial1).
+*******************************************************************************************************************************/
+#include <Arduino.h>
+#include <SD.h>
+#include <unistd.h>
+#include <time.h>
+#include "LedPanel.h"
+#include "Metronome.h"
+#include "Gloves.h"
+#include "Midi.h"
+#include "MidiClock.h"
+#include "LedSim.h"
+#include "APlayer2.h"
+#include "APlayer3.h"
+
+#define STEP_MICROS   1000    /* virtual time moves 1 ms per loop */
+
+LedPanel      ledPanel;
+Metronome     metronome;
+Gloves        gloves;
+Song          song;
+MidiInterface midi;
+MidiClock     midiClock(&midi);
+LedSim        ledSim;
+
+
+/* Print to a FILE (stdout, or the timing log) */
+class FilePrint : public Print {
+  public:
+    FilePrint(FILE* f) { _f = f; }
+    size_t write(uint8_t b) { fputc(b, _f); return 1; }
+    size_t write(const uint8_t* buf, size_t size) { return fwrite(buf, 1, size, _f); }
+    using Print::write;
+  private:
+    FILE* _f;
+};
+
+
+static void usage() {
+  fprintf(stderr, "usage: LedSimHost [-p 2|3] [-f ansi|ppm] [-t tempo%%] [-a animation] [-s seconds] [-g gain] "
+                  "[-l log.csv] [-r] SONG.TXT\n");
+}
+
+
+/* Real-time pacing: wait until the host clock has caught up with the virtual time */
+static void pace(uint32_t virtualMicros, const struct timespec* start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  int64_t hostMicros = (int64_t)(now.tv_sec - start->tv_sec) * 1000000 + (now.tv_nsec - start->tv_nsec) / 1000;
+  if ((int64_t)virtualMicros > hostMicros) usleep(virtualMicros - hostMicros);
+}
+
+
+template<class PLAYER> static uint32_t play(PLAYER& player, uint32_t maxMillis, bool realTime) {
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  uint32_t startMicros = micros();
+  while (!player.isSongFinished() && millis() < maxMillis) {
+    player.handlePlaying();
+    advanceMicros(STEP_MICROS);
+    if (realTime) pace(micros() - startMicros, &start);
+  }
+  player.stopPlayingNow();
+  return millis();
+}
+
+
+int main(int argc, char** argv) {
+  int practice = 3;
+  byte format = LEDSIM_ANSI;
+  uint16_t tempoFactor = 100;
+  byte animationSpeed = 2;
+  uint32_t maxMillis = 0xFFFFFFFF;
+  byte gain = 4;
+  const char* logPath = NULL;
+  bool realTime = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:f:t:a:s:g:l:r")) != -1) {
+    switch (opt) {
+      case 'p': practice = atoi(optarg); break;
+      case 'f': format = (strcasecmp(optarg, "ppm") == 0) ? LEDSIM_PPM : LEDSIM_ANSI; break;
+      case 't': tempoFactor = atoi(optarg); break;
+      case 'a': animationSpeed = atoi(optarg); break;
+      case 's': maxMillis = atol(optarg) * 1000; break;
+      case 'g': gain = atoi(optarg); break;
+      case 'l': logPath = optarg; break;
+      case 'r': realTime = true; break;
+      default: usage(); return 1;
+    }
+  }
+  if (optind != argc - 1 || (practice != 2 && practice != 3)) { usage(); return 1; }
+
+  File file = SD.open(argv[optind]);
+  if (!file) {
+    fprintf(stderr, "%s: cannot read file\n", argv[optind]);
+    return 1;
+  }
+  song.parseSong(1, &file, LOAD_FLAG_LEFT_COLOR | LOAD_FLAG_RIGHT_COLOR);
+  file.close();
+
+  FILE* logFile = NULL;
+  if (logPath != NULL && (logFile = fopen(logPath, "w")) == NULL) {
+    fprintf(stderr, "%s: cannot write file\n", logPath);
+    return 1;
+  }
+  FilePrint out(stdout);
+  FilePrint log(logFile);
+  ledSim.begin(&out, format, gain, (logFile != NULL) ? &log : NULL);
+  ledPanel.setSimulator(&ledSim);
+  midi.init_MIDI();
+  ledPanel.setMidi(&midi);
+  ledPanel.setMetronome(&metronome);
+
+  uint32_t endMillis;
+  if (practice == 2) {
+    static Player2 player(&ledPanel, &metronome, &midi, &gloves, &midiClock);
+    player.startSong(&song, 1, false, 0 /* no MIDI */, tempoFactor, false);
+    Serial1.receive(MidiType::NoteOn);   /* any piano key starts the song */
+    Serial1.receive(60);
+    Serial1.receive(100);
+    endMillis = play(player, maxMillis, realTime);
+  }
+  else {
+    static Player3 player(&ledPanel, &metronome, &midi, &gloves, &midiClock);
+    player.startSong(&song, 1, false, 0 /* no MIDI */, tempoFactor, animationSpeed, false);
+    endMillis = play(player, maxMillis, realTime);
+  }
+  fflush(stdout);
+  if (logFile != NULL) fclose(logFile);
+  fprintf(stderr, "%s: practice %d, %lu frames in %lu ms (virtual time)\n", argv[optind], practice,
+          (unsigned long)ledSim.frames, (unsigned long)endMillis);
+  return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef SD_h
+#define SD_h
+
+/******************************************************************************************************************************
+* SD library shim for the host: files of the current directory (the SD card), e.g. to parse a song file with Song::parseSong.
+*******************************************************************************************************************************/
+#include <Arduino.h>
+
+#define FILE_READ    0x01
+#define FILE_WRITE   0x13    /* O_READ | O_WRITE | O_CREAT | O_APPEND (SdFat) */
+#define O_READ       0x01
+#define O_RDWR       0x03
+#define O_WRITE      0x02
+#define O_APPEND     0x04
+#define O_CREAT      0x10
+#define O_TRUNC      0x40
+
+class File : public Print {
+  public:
+    File(FILE* f = NULL, const char* name = "");
+    int read();
+    int read(void* buf, size_t size);
+    int available();
+    size_t write(uint8_t b);
+    size_t write(const uint8_t* buf, size_t size);
+    using Print::write;
+    bool seek(uint32_t pos);
+    uint32_t position();
+    uint32_t size();
+    void flush();
+    void close();
+    char* name();
+    bool isDirectory() { return false; }
+    File openNextFile() { return File(); }   /* directories are not listed */
+    void rewindDirectory() {}
+    operator bool() { return _f != NULL; }
+
+  private:
+    FILE* _f;
+    char _name[13];
+};
+
+class SDClass {
+  public:
+    bool begin(int csPin) { return true; }
+    File open(const char* path, int mode = FILE_READ);
+    bool exists(const char* path);
+    bool remove(const char* path);
+};
+
+extern SDClass SD;
+
+
+
+#endif // SD_h
@@ -0,0 +1,104 @@
+/******************************************************************************************************************************
+* SongCapacity  -  host tool (PC), to size the fixed-size queues of the players
+*******************************************************************************************************************************
+* Reads song files (SONGxx.TXT, as on the SD card) and prints the worst case of each song for the queues of the players,
+* found by the same CapacityPlanner as the Arduino uses after loading a song (see Song::_planCapacity).
+*
+* Build and run (from this directory):
+*     g++ -std=c++11 -I../../1Main SongCapacity.cpp ../../1Main/CapacityPlanner.cpp -o SongCapacity
+*     ./SongCapacity SONG01.TXT SONG02.TXT
+*
+* All notes are planned (also notes of a hand that is not loaded, and notes outside the range of the piano), so the
+* result is never lower than on the Arduino.
+*******************************************************************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "CapacityPlanner.h"
+
+#define NOTES_MAX   10000     /* more than MAX_NOTES of the Arduino */
+
+
+class Note {
+  public:
+    uint32_t atTick;
+    uint32_t duration;
+};
+
+static Note notes[NOTES_MAX];
+
+
+/* From CAPACITY_NOTES_MAX the planner stops counting: the real worst case can be higher ('+') */
+void printCount(const char* what, uint16_t count, const char* queues) {
+  printf("  %-32s %3u%s (%s)\n", what, count, (count >= CAPACITY_NOTES_MAX) ? "+" : " ", queues);
+}
+
+
+/* Plan one song file, false if it cannot be read */
+bool planSong(const char* filename) {
+  FILE* file = fopen(filename, "r");
+  if (file == NULL) return false;
+  char row[200];
+  char name[100] = "";
+  uint32_t resolution = 0;
+  uint16_t tempoQPM = 0;       /* tempo in force */
+  uint16_t tempoMax = 0;       /* highest tempo of the song */
+  int noteCount = 0;
+  while (fgets(row, sizeof(row), file) != NULL) {
+    row[strcspn(row, "\r\n")] = 0;
+    char* value = strchr(row, ':');
+    if (value == NULL) continue;
+    *value++ = 0;
+    if      (strcasecmp(row, "name") == 0)       snprintf(name, sizeof(name), "%s", value);
+    else if (strcasecmp(row, "resolution") == 0) resolution = atoi(value);
+    else if (strcasecmp(row, "tempo") == 0)      tempoQPM = atoi(value);
+    else if (row[0] >= '0' && row[0] <= '9') {   /* MIDI-tick: measure or note, see Song::parseSong */
+      uint32_t tick = atol(row);
+      char* token = strtok(value, ",#");
+      if (token == NULL) continue;
+      if (strncasecmp(token, "measure", 7) == 0) {                       /* e.g.: "1080:Measure1,3,120,T130" */
+        strtok(NULL, ",#");                                              /* beats */
+        strtok(NULL, ",#");                                              /* ticks per beat */
+        token = strtok(NULL, ",#");
+        if (token != NULL && token[0] == 'T') tempoQPM = atoi(token + 1);
+        if (tempoQPM > tempoMax) tempoMax = tempoQPM;
+      }
+      else if ((token[0] == 'R' || token[0] == 'L' || token[0] == '_') && noteCount < NOTES_MAX) {  /* e.g.: "240:R1,60,100,120" */
+        strtok(NULL, ",#");                                              /* pitch */
+        strtok(NULL, ",#");                                              /* velocity */
+        token = strtok(NULL, ",#");
+        notes[noteCount].atTick = tick;
+        notes[noteCount].duration = (token != NULL) ? atol(token) : 0;
+        noteCount++;
+      }
+    }
+  }
+  fclose(file);
+
+  CapacityPlanner planner(resolution, tempoMax);
+  for (int i = 0; i < noteCount; i++) planner.addNote(notes[i].atTick, notes[i].duration);
+  printf("%s: %s\n", filename, name);
+  printf("  notes: %d, highest tempo: %u QPM, look-ahead: %u ticks (%d ms at %d%%)\n", noteCount, tempoMax,
+         planner.lookAheadTicks, CAPACITY_LOOK_AHEAD_MILLIS, CAPACITY_TEMPO_FACTOR);
+  printCount("sounding at the same time", planner.capacity.sounding, "LED_OFF_SCHEDULE_MAX, MIDI_MAX_DELAYED_MSG");
+  printCount("upcoming within look-ahead", planner.capacity.upcoming, "UPCOMING_NOTES_MAX");
+  printCount("glove commands at the same time", planner.capacity.gloveCommands, "GLOVE_COMMANDS_MAX");
+  return true;
+}
+
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    printf("usage: SongCapacity SONG01.TXT [SONG02.TXT ...]\n");
+    return 1;
+  }
+  int result = 0;
+  for (int i = 1; i < argc; i++) {
+    if (!planSong(argv[i])) {
+      printf("%s: cannot read file\n", argv[i]);
+      result = 1;
+    }
+  }
+  return result;
+}